@@ -0,0 +1,420 @@
+/**
+ * @file Benchmarks.cpp
+ * @brief Micro benchmarks of the hot functions and a macro benchmark of whole runs at 1..N threads.
+ *
+ * Every benchmark uses fixed seeds and the built-in portfolio below, so two builds can be compared on identical
+ * work: run `finances_bench --benchmark_out=before.json` on each commit and diff the files, e.g. with Google
+ * Benchmark's tools/compare.py.
+ */
+
+#include <algorithm>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BatchEngine.hpp"
+#include "Config.hpp"
+#include "CounterRng.hpp"
+#include "CsvParser.hpp"
+#include "Debt.hpp"
+#include "Harness.hpp"
+#include "IncomeModel.hpp"
+#include "Portfolio.hpp"
+#include "Profile.hpp"
+#include "Sampler.hpp"
+#include "Scheduler.hpp"
+#include "Simulation.hpp"
+#include "Statistics.hpp"
+#include "Strategy.hpp"
+#include "Sweep.hpp"
+#include "ThreadPool.hpp"
+#include "Worker.hpp"
+#include "flags.hpp"
+
+namespace {
+
+constexpr uint64_t SEED = 42;  ///< Seed of every random stream in the suite.
+
+/**
+ * @brief Builds the portfolio of the repository's debt.csv, with yearly rates as in a run.
+ * @return Debts of the reference portfolio.
+ */
+auto referenceDebts() -> std::vector<Debt> {
+    std::vector<Debt> debts;
+    auto add = [&](double principal, int taken, double rate, double minimum, const char* id) {
+        debts.emplace_back(principal, rate, Debt::PERIOD_YEARLY, id, minimum, taken);
+    };
+    add(1000.0, 0, 0.28, 0.0, "chase credit card");
+    add(2600.0, 0, 0.28, 0.0, "macbook");
+    add(2600.0, 48, 0.28, 0.0, "macbookIn4Yr");
+    add(500.0, 0, 0.18, 0.0, "visa credit card");
+    add(5000.0, 0, 0.0, 475.0, "auto");
+    add(100.0, 0, 0.0, 0.0, "lostBet");
+    const double studentRates[] = {0.034,  0.068,  0.034,  0.068,  0.068,  0.034,  0.0386, 0.0386, 0.0386, 0.0466,
+                                   0.0466, 0.0466, 0.0429, 0.0429, 0.0531, 0.0531, 0.0531};
+    int n = 0;
+    for (double rate : studentRates) {
+        std::string id = std::format("studentLoanA{}", static_cast<char>('A' + n++));
+        debts.emplace_back(1000.0, rate, Debt::PERIOD_YEARLY, id, 0.0, 0);
+    }
+    add(9000.0, 0, 0.06, 0.0, "studentLoanAR");
+    add(20000.0, 0, 0.079, 0.0, "studentLoanAS");
+    add(432000.0, 36, 0.0, 2000.0, "kid");
+    add(120000.0, 0, 0.0, 0.0, "downPayment");
+    return debts;
+}
+
+/**
+ * @brief Gets the profile of the reference portfolio under the default scenario, built once.
+ * @return Profile with a single cell.
+ */
+auto referenceProfiles() -> const std::vector<Profile>& {
+    static const std::vector<Profile> profiles = [] {
+        std::vector<Profile> res;
+        res.push_back({"bench", *Sweep::build(Config{}, referenceDebts())});
+        return res;
+    }();
+    return profiles;
+}
+
+/**
+ * @brief Gets the single cell of the reference profile.
+ * @return Default scenario on the reference portfolio.
+ */
+auto referenceCell() -> const Cell& { return referenceProfiles()[0].sweep.getCells()[0]; }
+
+// ---- Random numbers ----
+
+/**
+ * @brief One CounterRng draw per iteration.
+ * @param state Benchmark state.
+ */
+void counterRngUniform(bench::State& state) {
+    CounterRng rng(SEED, 0);
+    double sum = 0.0;
+    for (uint64_t i = 0; i < state.getIterations(); i++) {
+        sum += rng.uniform();
+    }
+    bench::doNotOptimize(sum);
+    state.setItemsProcessed(state.getIterations());
+}
+
+/**
+ * @brief Draws 128 months of one trajectory per iteration.
+ * @param state Benchmark state.
+ * @param mode Sampling scheme.
+ */
+void samplerUniform(bench::State& state, Sampler::MODE_E mode) {
+    Sampler sampler(SEED, 0, mode, 24);
+    double sum = 0.0;
+    for (uint64_t i = 0; i < state.getIterations(); i++) {
+        sampler.seek(i);
+        for (int m = 0; m < 128; m++) {
+            sum += sampler.uniform();
+        }
+    }
+    bench::doNotOptimize(sum);
+    state.setItemsProcessed(state.getIterations() * 128);
+}
+
+/**
+ * @brief One block of monthly payments per iteration.
+ * @param state Benchmark state.
+ */
+void incomeModelDraw(bench::State& state) {
+    const IncomeModel& income = referenceCell().income;
+    Sampler sampler(SEED, 0);
+    IncomeModel::Payments payments{};
+    int shock = 0;
+    for (uint64_t i = 0; i < state.getIterations(); i++) {
+        sampler.seek(i);
+        income.draw(sampler, 0, shock, payments);
+        bench::doNotOptimize(payments);
+    }
+    state.setItemsProcessed(state.getIterations() * IncomeModel::BLOCK);
+}
+
+// ---- Month steps, from the start of a trajectory ----
+
+/**
+ * @brief One Debt::accrue per iteration on every debt of the reference portfolio (the object-per-debt path).
+ * @param state Benchmark state.
+ */
+void debtAccrue(bench::State& state) {
+    const std::vector<Debt> initial = referenceDebts();
+    std::vector<Debt> debts = initial;
+    for (uint64_t i = 0; i < state.getIterations(); i++) {
+        if ((i % 12) == 0) {
+            debts = initial;
+        }
+        for (Debt& d : debts) {
+            d.accrue();
+        }
+    }
+    bench::doNotOptimize(debts);
+    state.setItemsProcessed(state.getIterations());
+}
+
+/**
+ * @brief One Portfolio::reset per iteration.
+ * @param state Benchmark state.
+ */
+void portfolioReset(bench::State& state) {
+    Portfolio pf = referenceCell().portfolio;
+    for (uint64_t i = 0; i < state.getIterations(); i++) {
+        pf.reset();
+        bench::doNotOptimize(pf);
+    }
+}
+
+/**
+ * @brief One Portfolio::accrue per iteration.
+ * @param state Benchmark state.
+ */
+void portfolioAccrue(bench::State& state) {
+    Portfolio pf = referenceCell().portfolio;
+    for (uint64_t i = 0; i < state.getIterations(); i++) {
+        // Restart every 12 months so the balances stay realistic
+        if ((i % 12) == 0) {
+            pf.reset();
+        }
+        pf.accrue();
+    }
+    bench::doNotOptimize(pf);
+    state.setItemsProcessed(state.getIterations());
+}
+
+/**
+ * @brief One month of forced and non-forced payments (accrual, payForced, payNonForced, retirePaidOff).
+ * @param state Benchmark state.
+ * @tparam Proportional Strategy::STRATEGY_PROPORTIONAL allocation instead of the cascade.
+ */
+template <bool Proportional>
+void portfolioPay(bench::State& state) {
+    Portfolio pf = referenceCell().portfolio;
+    double totalPaid = 0.0;
+    for (uint64_t i = 0; i < state.getIterations(); i++) {
+        if ((i % 12) == 0) {
+            pf.reset();
+        }
+        pf.accrue();
+        double payment = 2500.0;
+        pf.payForced<true>(payment);
+        pf.payNonForced<Proportional>(payment);
+        pf.retirePaidOff(totalPaid);
+    }
+    bench::doNotOptimize(totalPaid);
+    state.setItemsProcessed(state.getIterations());
+}
+
+/**
+ * @brief Orders a copy of the reference debts per iteration.
+ * @param state Benchmark state.
+ */
+void strategyOrder(bench::State& state) {
+    const std::vector<Debt> debts = referenceDebts();
+    for (uint64_t i = 0; i < state.getIterations(); i++) {
+        std::vector<Debt> copy = debts;
+        Strategy::order(copy, Strategy::STRATEGY_HYBRID, 1000.0);
+        bench::doNotOptimize(copy);
+    }
+    state.setItemsProcessed(state.getIterations() * debts.size());
+}
+
+// ---- Engines: one chunk of whole trajectories ----
+
+/**
+ * @brief Simulates BATCH_CHUNK trajectories per iteration with one BatchEngine kernel.
+ * @param state Benchmark state.
+ * @param isa Kernel.
+ */
+void batchEngine(bench::State& state, BatchEngine::ISA_E isa) {
+    const Cell& cell = referenceCell();
+    std::vector<TrajectoryResult> out(BATCH_CHUNK);
+    BatchEngine engine(cell.portfolio, cell.income, Sampler(SEED, 0), cell.scenario, isa);
+    for (uint64_t i = 0; i < state.getIterations(); i++) {
+        engine.run(0, BATCH_CHUNK, out.data());
+        bench::doNotOptimize(out);
+    }
+    state.setItemsProcessed(state.getIterations() * BATCH_CHUNK);
+}
+
+/**
+ * @brief Simulates BATCH_CHUNK trajectories per iteration with a scalar engine of a Worker.
+ * @param state Benchmark state.
+ * @param events Uses the event-driven engine instead of the month-by-month one.
+ */
+void scalarEngine(bench::State& state, bool events) {
+    const Cell& cell = referenceCell();
+    Portfolio debts = cell.portfolio;
+    std::vector<TrajectoryResult> out(BATCH_CHUNK);
+    Job job;
+    job.seed = SEED;
+    job.simd = false;
+    job.events = events;
+    Worker worker(0, job);
+    for (uint64_t i = 0; i < state.getIterations(); i++) {
+        worker.simulateChunk(cell, debts, 0, 0, BATCH_CHUNK, out.data());
+        bench::doNotOptimize(out);
+    }
+    state.setItemsProcessed(state.getIterations() * BATCH_CHUNK);
+}
+
+// ---- Statistics, scheduling and parsing ----
+
+/**
+ * @brief Adds one trajectory result to a ResultStats per iteration.
+ * @param state Benchmark state.
+ */
+void resultStatsAdd(bench::State& state) {
+    ResultStats stats;
+    CounterRng rng(SEED, 0);
+    for (uint64_t i = 0; i < state.getIterations(); i++) {
+        stats.add({rng.uniform(179000.0, 181000.0), 60 + static_cast<int>(i % 16)});
+    }
+    bench::doNotOptimize(stats);
+    state.setItemsProcessed(state.getIterations());
+}
+
+/**
+ * @brief Builds a Scheduler for 1M iterations on 8 threads and drains it per iteration.
+ * @param state Benchmark state.
+ */
+void schedulerNext(bench::State& state) {
+    uint64_t chunks = 0;
+    for (uint64_t i = 0; i < state.getIterations(); i++) {
+        Scheduler scheduler(1024 * 1024, 8, 8, BATCH_CHUNK);
+        for (unsigned int t = 0; t < 8; t++) {
+            while (scheduler.next(t)) {
+                chunks++;
+            }
+        }
+    }
+    bench::doNotOptimize(chunks);
+    state.setItemsProcessed(chunks);
+}
+
+/**
+ * @brief Gets a 10k-row file in the debt.csv format with quoted ids, written on first use.
+ * @return Path of the file.
+ */
+auto csvFile() -> const std::string& {
+    static const std::string path = [] {
+        std::string p = (std::filesystem::temp_directory_path() / "finances_bench.csv").string();
+        std::ofstream file(p);
+        for (int i = 0; i < 10000; i++) {
+            file << std::format("{}.0,{},0.0{},{}.0,\"loan \"\"{}\"\"\"\n", 1000 + i, i % 48, i % 9, i % 3, i);
+        }
+        return p;
+    }();
+    return path;
+}
+
+/**
+ * @brief Parses the debt file into typed records per iteration, as Profile::loadDebts does.
+ * @param state Benchmark state.
+ */
+void csvParserForEachRecord(bench::State& state) {
+    const std::string& path = csvFile();
+    uint64_t rows = 0;
+    for (uint64_t i = 0; i < state.getIterations(); i++) {
+        CsvParser csv(path);
+        csv.forEachRecord<double, int, double, double, std::string_view>(
+            [&](double, int, double, double, std::string_view) { rows++; });
+    }
+    state.setItemsProcessed(rows);
+    state.setBytesProcessed(state.getIterations() * std::filesystem::file_size(path));
+}
+
+/**
+ * @brief Parses the debt file into rows of strings per iteration with the legacy CsvParser::parse.
+ * @param state Benchmark state.
+ */
+void csvParserParse(bench::State& state) {
+    const std::string& path = csvFile();
+    uint64_t rows = 0;
+    for (uint64_t i = 0; i < state.getIterations(); i++) {
+        CsvParser csv(path);
+        rows += csv.parse()->size();
+    }
+    state.setItemsProcessed(rows);
+    state.setBytesProcessed(state.getIterations() * std::filesystem::file_size(path));
+}
+
+// ---- Macro: whole runs through the library API ----
+
+/**
+ * @brief Simulates 64k trajectories per iteration with simulate() on a warm thread pool, as an embedding service does.
+ * @param state Benchmark state.
+ * @param threads Number of pool threads.
+ */
+void simulateRun(bench::State& state, unsigned int threads) {
+    constexpr uint64_t ITERATIONS = 65536;
+    ThreadPool pool(threads);
+    Options options;
+    options.seed = SEED;
+    options.pool = &pool;
+    for (uint64_t i = 0; i < state.getIterations(); i++) {
+        std::optional<Results> results = simulate(referenceProfiles(), ITERATIONS, options);
+        bench::doNotOptimize(results);
+    }
+    state.setItemsProcessed(state.getIterations() * ITERATIONS);
+}
+
+/**
+ * @brief Registers every benchmark of the suite.
+ */
+void registerAll() {
+    bench::registerBenchmark("BM_CounterRng_Uniform", counterRngUniform);
+    for (int m = 0; m < Sampler::MODE_COUNT; m++) {
+        auto mode = static_cast<Sampler::MODE_E>(m);
+        bench::registerBenchmark("BM_Sampler_Uniform/" + Sampler::printMode(mode),
+                                 [mode](bench::State& s) { samplerUniform(s, mode); });
+    }
+    bench::registerBenchmark("BM_IncomeModel_Draw", incomeModelDraw);
+    bench::registerBenchmark("BM_Debt_Accrue", debtAccrue);
+    bench::registerBenchmark("BM_Portfolio_Reset", portfolioReset);
+    bench::registerBenchmark("BM_Portfolio_Accrue", portfolioAccrue);
+    bench::registerBenchmark("BM_Portfolio_PayMonth/cascade", portfolioPay<false>);
+    bench::registerBenchmark("BM_Portfolio_PayMonth/proportional", portfolioPay<true>);
+    bench::registerBenchmark("BM_Strategy_Order/hybrid", strategyOrder);
+    for (int isa = BatchEngine::ISA_SCALAR; isa <= BatchEngine::detectIsa(); isa++) {
+        auto kernel = static_cast<BatchEngine::ISA_E>(isa);
+        bench::registerBenchmark("BM_BatchEngine_Chunk/" + BatchEngine::printIsa(kernel),
+                                 [kernel](bench::State& s) { batchEngine(s, kernel); });
+    }
+    bench::registerBenchmark("BM_Worker_ScalarChunk", [](bench::State& s) { scalarEngine(s, false); });
+    bench::registerBenchmark("BM_Worker_EventChunk", [](bench::State& s) { scalarEngine(s, true); });
+    bench::registerBenchmark("BM_ResultStats_Add", resultStatsAdd);
+    bench::registerBenchmark("BM_Scheduler_Next", schedulerNext);
+    bench::registerBenchmark("BM_CsvParser_ForEachRecord", csvParserForEachRecord);
+    bench::registerBenchmark("BM_CsvParser_Parse", csvParserParse);
+    // 1, 2, 4, ... threads, then every core
+    unsigned int cores = std::max(1U, std::thread::hardware_concurrency());
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int t = 1; t < cores; t *= 2) {
+        threadCounts.push_back(t);
+    }
+    threadCounts.push_back(cores);
+    for (unsigned int t : threadCounts) {
+        bench::registerBenchmark(std::format("BM_Simulate/threads:{}", t),
+                                 [t](bench::State& s) { simulateRun(s, t); }, static_cast<int>(t));
+    }
+}
+
+}  // namespace
+
+/**
+ * @brief Entry point of the benchmark suite.
+ * @param argc Argument count.
+ * @param argv Arguments, see bench::runAll.
+ * @return Exit code (0 for success).
+ */
+auto main(int argc, char** argv) -> int {
+    registerAll();
+    return bench::runAll(argc, argv);
+}
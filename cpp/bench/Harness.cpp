@@ -0,0 +1,276 @@
+/**
+ * @file Harness.cpp
+ * @brief Implements the benchmark runner and its console and JSON reports.
+ */
+
+#include "Harness.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <ctime>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <print>
+#include <string_view>
+#include <thread>
+
+namespace bench {
+
+namespace {
+
+/**
+ * @struct Entry
+ * @brief A registered benchmark.
+ */
+struct Entry {
+    std::string name;  ///< Reported name.
+    Function f;        ///< Benchmark body.
+    int threads;       ///< Threads used by the body.
+};
+
+/**
+ * @struct Result
+ * @brief Measurement of one benchmark.
+ */
+struct Result {
+    const Entry* entry;     ///< Measured benchmark.
+    uint64_t iterations;    ///< Iterations of the final run.
+    double realNs;          ///< Wall-clock time per iteration.
+    double cpuNs;           ///< Process CPU time per iteration.
+    double itemsPerSecond;  ///< Items processed per wall-clock second (0 = not reported).
+    double bytesPerSecond;  ///< Bytes processed per wall-clock second (0 = not reported).
+};
+
+/**
+ * @brief Gets the registry, constructed on first use so benchmarks can register from static initializers.
+ * @return Registered benchmarks in registration order.
+ */
+auto registry() -> std::vector<Entry>& {
+    static std::vector<Entry> entries;
+    return entries;
+}
+
+/**
+ * @brief Gets the CPU time consumed by every thread of the process.
+ * @return CPU time in nanoseconds.
+ */
+auto cpuNow() -> double {
+    timespec ts{};
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (static_cast<double>(ts.tv_sec) * 1e9) + static_cast<double>(ts.tv_nsec);
+}
+
+/**
+ * @brief Runs a benchmark with growing iteration counts until one run lasts at least minTime.
+ * @param e Benchmark to run.
+ * @param minTime Shortest accepted run, in seconds.
+ * @return Measurement of the final run.
+ */
+auto measure(const Entry& e, double minTime) -> Result {
+    uint64_t n = 1;
+    while (true) {
+        State state(n);
+        double cpuStart = cpuNow();
+        auto start = std::chrono::steady_clock::now();
+        e.f(state);
+        double real = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double cpu = (cpuNow() - cpuStart) * 1e-9;
+        // Same growth rule as Google Benchmark: aim 40% past the target, at most 10x per step
+        if ((real >= minTime) || (n >= 1000000000)) {
+            auto iterations = static_cast<double>(n);
+            return {&e,
+                    n,
+                    real * 1e9 / iterations,
+                    cpu * 1e9 / iterations,
+                    (state.getItems() != 0) ? static_cast<double>(state.getItems()) / real : 0.0,
+                    (state.getBytes() != 0) ? static_cast<double>(state.getBytes()) / real : 0.0};
+        }
+        double multiplier = (real > 0.0) ? std::clamp(minTime * 1.4 / real, 2.0, 10.0) : 10.0;
+        n = static_cast<uint64_t>(static_cast<double>(n) * multiplier);
+    }
+}
+
+/**
+ * @brief Formats a time per iteration with the largest unit keeping it at or above 1.
+ * @param ns Time in nanoseconds.
+ * @return Formatted time, e.g. "12.3 us".
+ */
+auto formatTime(double ns) -> std::string {
+    if (ns >= 1e9) {
+        return std::format("{:.2f} s", ns * 1e-9);
+    }
+    if (ns >= 1e6) {
+        return std::format("{:.2f} ms", ns * 1e-6);
+    }
+    if (ns >= 1e3) {
+        return std::format("{:.2f} us", ns * 1e-3);
+    }
+    return std::format("{:.2f} ns", ns);
+}
+
+/**
+ * @brief Formats a rate with a k/M/G suffix, as Google Benchmark's console reporter does.
+ * @param x Rate per second.
+ * @return Formatted rate, e.g. "81.2M".
+ */
+auto formatRate(double x) -> std::string {
+    if (x >= 1e9) {
+        return std::format("{:.3g}G", x * 1e-9);
+    }
+    if (x >= 1e6) {
+        return std::format("{:.3g}M", x * 1e-6);
+    }
+    if (x >= 1e3) {
+        return std::format("{:.3g}k", x * 1e-3);
+    }
+    return std::format("{:.3g}", x);
+}
+
+/**
+ * @brief Serializes the results in Google Benchmark's JSON format (comparable with its tools/compare.py).
+ * @param results Measurements.
+ * @param executable Path of the benchmark binary.
+ * @return JSON text.
+ */
+auto toJson(const std::vector<Result>& results, const std::string& executable) -> std::string {
+    std::array<char, 256> host{};
+    gethostname(host.data(), host.size() - 1);
+    std::time_t now = std::time(nullptr);
+    std::array<char, 64> date{};
+    std::strftime(date.data(), date.size(), "%Y-%m-%dT%H:%M:%S%z", std::localtime(&now));
+
+    std::string res = "{\n  \"context\": {\n";
+    res += std::format("    \"date\": \"{}\",\n    \"host_name\": \"{}\",\n    \"executable\": \"{}\",\n", date.data(),
+                       host.data(), executable);
+    res += std::format("    \"num_cpus\": {},\n    \"library_build_type\": \"release\"\n  }},\n",
+                       std::thread::hardware_concurrency());
+    res += "  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        res += std::format(
+            "    {{\n      \"name\": \"{}\",\n      \"run_name\": \"{}\",\n      \"run_type\": \"iteration\",\n"
+            "      \"repetitions\": 1,\n      \"repetition_index\": 0,\n      \"threads\": {},\n"
+            "      \"iterations\": {},\n      \"real_time\": {:.6e},\n      \"cpu_time\": {:.6e},\n"
+            "      \"time_unit\": \"ns\"",
+            r.entry->name, r.entry->name, r.entry->threads, r.iterations, r.realNs, r.cpuNs);
+        if (r.itemsPerSecond > 0.0) {
+            res += std::format(",\n      \"items_per_second\": {:.6e}", r.itemsPerSecond);
+        }
+        if (r.bytesPerSecond > 0.0) {
+            res += std::format(",\n      \"bytes_per_second\": {:.6e}", r.bytesPerSecond);
+        }
+        res += std::format("\n    }}{}\n", (i + 1 < results.size()) ? "," : "");
+    }
+    return res + "  ]\n}\n";
+}
+
+}  // namespace
+
+/**
+ * @brief Registers a benchmark.
+ * @param name Name reported for the benchmark, e.g. "BM_Simulate/threads:4".
+ * @param f Benchmark body.
+ * @param threads Number of threads the body uses, reported in the output.
+ */
+void registerBenchmark(std::string name, Function f, int threads) {
+    registry().push_back({std::move(name), std::move(f), threads});
+}
+
+/**
+ * @brief Runs every registered benchmark matching the filter and prints the results.
+ * @param argc Argument count.
+ * @param argv Arguments: --benchmark_filter=SUBSTRING, --benchmark_min_time=SECONDS,
+ *             --benchmark_format=console|json, --benchmark_out=FILE (always JSON), --benchmark_list_tests.
+ * @return Exit code (0 for success).
+ */
+auto runAll(int argc, char** argv) -> int {
+    std::string filter;
+    double minTime = 0.5;
+    bool json = false;
+    bool list = false;
+    std::string out;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        std::string_view value = arg.substr(std::min(arg.find('=') + 1, arg.size()));
+        if (arg.starts_with("--benchmark_filter=")) {
+            filter = value;
+        } else if (arg.starts_with("--benchmark_min_time=")) {
+            // Google Benchmark accepts an "s" suffix
+            if (value.ends_with('s')) {
+                value.remove_suffix(1);
+            }
+            auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), minTime);
+            if ((ec != std::errc()) || (ptr != value.data() + value.size()) || (minTime <= 0.0)) {
+                std::cerr << "Error: Invalid value for benchmark_min_time: " << value << '\n';
+                return 1;
+            }
+        } else if (arg.starts_with("--benchmark_format=")) {
+            json = (value == "json");
+            if (!json && (value != "console")) {
+                std::cerr << "Error: Invalid value for benchmark_format: " << value << '\n';
+                return 1;
+            }
+        } else if (arg.starts_with("--benchmark_out=")) {
+            out = value;
+        } else if (arg == "--benchmark_list_tests") {
+            list = true;
+        } else {
+            std::cerr << "Error: Unexpected argument: " << arg << '\n';
+            std::cerr << "usage: finances_bench [--benchmark_filter=SUBSTRING] [--benchmark_min_time=SECONDS] "
+                         "[--benchmark_format=console|json] [--benchmark_out=FILE] [--benchmark_list_tests]\n";
+            return 1;
+        }
+    }
+
+    std::vector<Result> results;
+    if (!json && !list) {
+        std::println("{:-<100}", "");
+        std::println("{:<48} {:>14} {:>14} {:>12}", "Benchmark", "Time", "CPU", "Iterations");
+        std::println("{:-<100}", "");
+    }
+    for (const Entry& e : registry()) {
+        if (e.name.find(filter) == std::string::npos) {
+            continue;
+        }
+        if (list) {
+            std::println("{}", e.name);
+            continue;
+        }
+        Result r = measure(e, minTime);
+        results.push_back(r);
+        if (!json) {
+            std::string counters;
+            if (r.itemsPerSecond > 0.0) {
+                counters += std::format(" items_per_second={}/s", formatRate(r.itemsPerSecond));
+            }
+            if (r.bytesPerSecond > 0.0) {
+                counters += std::format(" bytes_per_second={}B/s", formatRate(r.bytesPerSecond));
+            }
+            std::println("{:<48} {:>14} {:>14} {:>12}{}", e.name, formatTime(r.realNs), formatTime(r.cpuNs),
+                         r.iterations, counters);
+        }
+    }
+    if (list) {
+        return 0;
+    }
+    std::string report = toJson(results, argv[0]);
+    if (json) {
+        std::print("{}", report);
+    }
+    if (!out.empty()) {
+        std::ofstream file(out);
+        if (!file.is_open()) {
+            std::cerr << "Error: Could not open file: " << out << '\n';
+            return 1;
+        }
+        file << report;
+    }
+    return 0;
+}
+
+}  // namespace bench
@@ -0,0 +1,74 @@
+/**
+ * @file Harness.hpp
+ * @brief Defines a minimal benchmark harness whose command line and JSON output follow Google Benchmark.
+ */
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+/**
+ * @class State
+ * @brief Handed to a benchmark function: how many iterations to run and what they processed.
+ */
+class State {
+ private:
+    uint64_t iterations;  ///< Number of iterations the function must run.
+    uint64_t items = 0;   ///< Items processed by all iterations (0 = not reported).
+    uint64_t bytes = 0;   ///< Bytes processed by all iterations (0 = not reported).
+
+ public:
+    /**
+     * @brief Constructs a State.
+     * @param iterations Number of iterations the function must run.
+     */
+    explicit State(uint64_t iterations) : iterations(iterations) {}
+
+    [[nodiscard]] auto getIterations() const -> uint64_t { return this->iterations; }
+    [[nodiscard]] auto getItems() const -> uint64_t { return this->items; }
+    [[nodiscard]] auto getBytes() const -> uint64_t { return this->bytes; }
+    /**
+     * @brief Reports the items processed by all iterations, printed as items_per_second.
+     * @param n Number of items.
+     */
+    void setItemsProcessed(uint64_t n) { this->items = n; }
+    /**
+     * @brief Reports the bytes processed by all iterations, printed as bytes_per_second.
+     * @param n Number of bytes.
+     */
+    void setBytesProcessed(uint64_t n) { this->bytes = n; }
+};
+
+using Function = std::function<void(State&)>;  ///< Benchmark body; runs State::getIterations() iterations.
+
+/**
+ * @brief Keeps the compiler from optimizing a value (and the work producing it) away.
+ * @param value Value to keep.
+ */
+template <typename T>
+inline void doNotOptimize(T& value) {
+    asm volatile("" : "+m"(value) : : "memory");
+}
+
+/**
+ * @brief Registers a benchmark.
+ * @param name Name reported for the benchmark, e.g. "BM_Simulate/threads:4".
+ * @param f Benchmark body.
+ * @param threads Number of threads the body uses, reported in the output.
+ */
+void registerBenchmark(std::string name, Function f, int threads = 1);
+
+/**
+ * @brief Runs every registered benchmark matching the filter and prints the results.
+ * @param argc Argument count.
+ * @param argv Arguments: --benchmark_filter=SUBSTRING, --benchmark_min_time=SECONDS,
+ *             --benchmark_format=console|json, --benchmark_out=FILE (always JSON), --benchmark_list_tests.
+ * @return Exit code (0 for success).
+ */
+auto runAll(int argc, char** argv) -> int;
+
+}  // namespace bench
@@ -0,0 +1,55 @@
+/**
+ * @file Adaptive.hpp
+ * @brief Defines the stopping rule of adaptive runs, which end once the estimates are precise enough.
+ */
+#pragma once
+
+#include <cstdint>
+
+#include "Statistics.hpp"
+
+/**
+ * @class Adaptive
+ * @brief Decides, round after round, how many iterations to simulate until the confidence intervals are narrow enough.
+ *
+ * Rounds extend the same iteration sequence (every block resumes where it stopped), and each decision only depends
+ * on the statistics of the finished rounds, so an adaptive run is deterministic for a given seed, whatever the
+ * thread count, and a run reaching the cap simulates the same trajectories as a fixed-count run of the same size.
+ */
+class Adaptive {
+ private:
+    double target;     ///< Largest accepted relative half-width of the confidence intervals (0 = disabled).
+    double z;          ///< Two-sided normal quantile of the confidence level.
+    uint64_t cap;      ///< Hard limit on the number of iterations.
+    uint64_t minimum;  ///< Size of the first round.
+
+ public:
+    /**
+     * @brief Constructs an Adaptive stopping rule.
+     * @param target Largest accepted relative half-width of the confidence intervals; 0 disables early exit.
+     * @param confidence Confidence level of the intervals, in (0, 1).
+     * @param cap Hard limit on the number of iterations.
+     * @param minimum Size of the first round.
+     */
+    Adaptive(double target, double confidence, uint64_t cap, uint64_t minimum);
+
+    [[nodiscard]] auto isEnabled() const -> bool { return this->target > 0.0; }
+    /**
+     * @brief Gets the number of iterations of the first round.
+     * @return Iterations to simulate first.
+     */
+    [[nodiscard]] auto firstRound() const -> uint64_t;
+    /**
+     * @brief Gets the relative half-width of the confidence interval of a mean.
+     * @param s Accumulator.
+     * @return Half-width divided by the magnitude of the mean (0 for a constant sample).
+     */
+    [[nodiscard]] auto halfWidth(const RunningStats& s) const -> double;
+    /**
+     * @brief Decides the total number of iterations after a round.
+     * @param done Iterations simulated so far.
+     * @param widest Largest relative half-width over every estimate.
+     * @return New total, or done to stop.
+     */
+    [[nodiscard]] auto nextRound(uint64_t done, double widest) const -> uint64_t;
+};
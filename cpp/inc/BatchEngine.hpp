@@ -0,0 +1,89 @@
+/**
+ * @file BatchEngine.hpp
+ * @brief Defines an engine that advances several independent trajectories together, one per vector lane.
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "IncomeModel.hpp"
+#include "Portfolio.hpp"
+#include "Sampler.hpp"
+#include "Scenario.hpp"
+#include "TrajectoryResult.hpp"
+
+/**
+ * @class BatchEngine
+ * @brief Simulates trajectories in lock-step batches using masked vector operations.
+ *
+ * Every lane holds one trajectory. Accrual, forced payments and the payment cascade run as masked vector ops
+ * over all lanes; a lane whose trajectory finishes is retired, and the batch is refilled with the next iterations
+ * once all of its lanes have retired. The kernel is picked at runtime from the CPU (AVX-512VL, AVX2 or a portable
+ * one-lane fallback). Each lane performs exactly the scalar Portfolio arithmetic on its own random stream, so every
+ * kernel produces bit-identical results.
+ */
+class BatchEngine {
+ public:
+    /**
+     * @enum ISA_E
+     * @brief Instruction set the batch kernel is compiled for.
+     */
+    using ISA_E = enum { ISA_SCALAR, ISA_AVX2, ISA_AVX512, ISA_COUNT };
+
+ private:
+    const Portfolio& portfolio;           ///< Portfolio every lane starts from.
+    Sampler sampler;                      ///< Payment draws of the block, copied into every lane.
+    const IncomeModel& income;            ///< Payment ranges of the scenario.
+    bool aggressive;                      ///< Payments freed from forced debts go into the other debts.
+    bool kid;                             ///< Trajectories end once only the kid debt is left.
+    bool proportional;                    ///< The extra payment is split in proportion to the balances.
+    int maxPeriods;                       ///< Periods after which a trajectory with debt left is stopped.
+    ISA_E isa;                            ///< Kernel selected for this engine.
+
+ public:
+    /**
+     * @brief Constructs a BatchEngine.
+     * @param portfolio Portfolio every trajectory starts from; must outlive the engine.
+     * @param income Payment ranges of the scenario; must outlive the engine.
+     * @param sampler Payment draws of the block.
+     * @param scenario Scenario selecting the policy of the kernel.
+     * @param isa Kernel to use; defaults to the best one supported by the CPU.
+     */
+    BatchEngine(const Portfolio& portfolio, const IncomeModel& income, const Sampler& sampler, const Scenario& scenario,
+                ISA_E isa = detectIsa())
+        : portfolio(portfolio),
+          sampler(sampler),
+          income(income),
+          aggressive(scenario.aggressive),
+          kid(scenario.kid),
+          proportional(Strategy::isProportional(scenario.strategy)),
+          maxPeriods(scenario.maxPeriods),
+          isa(isa) {}
+
+    /**
+     * @brief Simulates iterations [begin, end).
+     * @param begin First iteration.
+     * @param end One past the last iteration.
+     * @param out Destination; the result of iteration i is written to out[i - begin].
+     */
+    void run(int begin, int end, TrajectoryResult* out) const;
+
+    /**
+     * @brief Detects the widest kernel supported by the CPU.
+     * @return Kernel to use.
+     */
+    static auto detectIsa() -> ISA_E;
+    /**
+     * @brief Gets the number of trajectories advanced together by a kernel.
+     * @param isa Kernel.
+     * @return Number of lanes.
+     */
+    static auto laneWidth(ISA_E isa) -> int;
+    /**
+     * @brief Converts a kernel to a string.
+     * @param isa Kernel.
+     * @return String representation of the kernel.
+     */
+    static auto printIsa(ISA_E isa) -> std::string;
+};
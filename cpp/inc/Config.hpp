@@ -0,0 +1,80 @@
+/**
+ * @file Config.hpp
+ * @brief Defines the runtime configuration, read from the command line and optional config files.
+ */
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Sampler.hpp"
+#include "Scenario.hpp"
+
+/**
+ * @struct Config
+ * @brief Everything a run needs: the scenario plus where to read debts and what to output.
+ *
+ * Options are given as `--key=value` or `--key value` on the command line, or as `key=value` lines in a file
+ * passed with `--config` (`#` starts a comment). Later options override earlier ones, except `--sweep`, which
+ * accumulates one axis per occurrence.
+ */
+struct Config {
+    Scenario scenario;                  ///< Scenario fed into the engine.
+    std::string debtFile = "../debt.csv";  ///< CSV file describing the debts.
+    std::string portfolios;             ///< Batch mode: directory of debt files or manifest listing them.
+    double targetCi = 0.0;              ///< Adaptive mode: stop once every CI half-width is below this fraction of its mean.
+    double confidence = 0.95;           ///< Confidence level of the adaptive mode's intervals.
+    uint64_t minIterations = 16384;     ///< Size of the adaptive mode's first round.
+    Sampler::MODE_E sampling = Sampler::MODE_PLAIN;  ///< Sampling scheme of the payment draws.
+    int samplingMonths = 24;            ///< Months covered by halton or stratified sampling.
+    unsigned int replicates = 16;       ///< Least number of blocks when sampling is not plain.
+    std::optional<uint64_t> seed;       ///< Seed of every random stream; drawn from the system if unset.
+    unsigned int shard = 0;             ///< Shard of the blocks to simulate, in [0, shards).
+    unsigned int shards = 1;            ///< Number of processes the run is split between (1 = not sharded).
+    unsigned int threads = 0;           ///< Number of worker threads (0 = hardware concurrency).
+    bool simd = true;                   ///< Advances several trajectories per vector lane (see BatchEngine).
+    bool events = false;                ///< Skips the quiet periods between events (see Worker::simulateEvents).
+    bool writeResults = false;          ///< Writes one raw row per iteration in addition to the statistics.
+    bool resultBinary = true;           ///< Raw rows go to columnar simulations.bin instead of simulations.csv.
+    uint64_t recordEvery = 0;           ///< Records the monthly balances of every Nth iteration to trajectories.bin (0 = off).
+    bool json = false;                  ///< Prints the statistics as JSON instead of the summary lines.
+    std::vector<std::string> sweep;     ///< Sweep axes as "key=value,value,...", expanded by Sweep.
+    std::string options;                ///< key=value lines of every applied option that can change the statistics.
+
+    /**
+     * @brief Builds a configuration from the command line.
+     * @param argc Argument count.
+     * @param argv Argument values.
+     * @return The configuration, or std::nullopt on invalid input or --help.
+     */
+    static auto parse(int argc, char** argv) -> std::optional<Config>;
+
+    /**
+     * @brief Applies one option.
+     * @param key Option name without leading dashes.
+     * @param value Option value.
+     * @return True if the option is known and its value valid.
+     */
+    auto set(std::string_view key, std::string_view value) -> bool;
+    /**
+     * @brief Applies every `key=value` line of a config file.
+     * @param path Path of the config file.
+     * @return True if the file could be read and every option is valid.
+     */
+    auto load(const std::string& path) -> bool;
+    /**
+     * @brief Applies every `key=value` line of a text, such as the options recorded by another run.
+     * @param text Lines to apply.
+     * @param source Name of the text in error messages.
+     * @return True if every option is valid.
+     */
+    auto apply(std::string_view text, std::string_view source) -> bool;
+
+    /**
+     * @brief Prints the list of options.
+     */
+    static void printUsage();
+};
@@ -0,0 +1,95 @@
+/**
+ * @file CounterRng.hpp
+ * @brief Defines a counter-based random number generator keyed by (seed, stream, trajectory).
+ */
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+/**
+ * @class CounterRng
+ * @brief Stateless-style generator: the n-th draw of a trajectory is a pure function of (key, n).
+ *
+ * Each Worker owns one instance, so no locking is needed, and any single trajectory can be replayed by
+ * re-keying with the same (seed, stream, trajectory) triple.
+ */
+class CounterRng {
+ private:
+    static constexpr uint64_t GOLDEN = 0x9E3779B97F4A7C15ULL;  ///< SplitMix64 increment (2^64 / phi).
+
+    uint64_t seed;     ///< Global seed of the run.
+    uint64_t stream;   ///< Independent stream id (e.g. the worker id).
+    uint64_t key;      ///< Key derived from (seed, stream, trajectory).
+    uint64_t counter;  ///< Index of the next draw within the trajectory.
+
+    /**
+     * @brief SplitMix64 finalizer; a bijective 64-bit mixing function.
+     * @param z Value to mix.
+     * @return Mixed value.
+     */
+    static constexpr auto mix(uint64_t z) -> uint64_t {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+ public:
+    using result_type = uint64_t;
+
+    /**
+     * @brief Constructs a generator positioned at the start of a trajectory.
+     * @param seed Global seed of the run.
+     * @param stream Independent stream id.
+     * @param trajectory Trajectory (iteration) index within the stream.
+     */
+    CounterRng(uint64_t seed, uint64_t stream, uint64_t trajectory = 0) : seed(seed), stream(stream), key(0), counter(0) {
+        seek(trajectory);
+    }
+
+    /**
+     * @brief Re-keys the generator for a trajectory and rewinds it to its first draw.
+     * @param trajectory Trajectory (iteration) index within the stream.
+     */
+    constexpr void seek(uint64_t trajectory) {
+        this->key = mix(mix(mix(this->seed) + this->stream) + trajectory);
+        this->counter = 0;
+    }
+
+    /**
+     * @brief Random access to the n-th draw of the current trajectory.
+     * @param n Draw index.
+     * @return 64 random bits.
+     */
+    [[nodiscard]] constexpr auto at(uint64_t n) const -> result_type { return mix(this->key + (GOLDEN * (n + 1))); }
+
+    /**
+     * @brief Next 64 random bits of the current trajectory.
+     * @return 64 random bits.
+     */
+    constexpr auto operator()() -> result_type { return at(this->counter++); }
+
+    /**
+     * @brief Converts 64 random bits to a uniform double in [0, 1) with 53 bits of precision.
+     * @param bits Random bits, e.g. from at().
+     * @return Uniform sample.
+     */
+    static constexpr auto toUniform(result_type bits) -> double { return static_cast<double>(bits >> 11) * 0x1.0p-53; }
+
+    /**
+     * @brief Next uniform double in [0, 1) with 53 bits of precision.
+     * @return Uniform sample.
+     */
+    constexpr auto uniform() -> double { return toUniform((*this)()); }
+
+    /**
+     * @brief Next uniform double in [lo, hi).
+     * @param lo Lower bound.
+     * @param hi Upper bound.
+     * @return Uniform sample.
+     */
+    constexpr auto uniform(double lo, double hi) -> double { return lo + ((hi - lo) * uniform()); }
+
+    static constexpr auto min() -> result_type { return 0; }
+    static constexpr auto max() -> result_type { return std::numeric_limits<result_type>::max(); }
+};
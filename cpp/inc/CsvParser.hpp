@@ -1,29 +1,132 @@
 /**
  * @file CsvParser.hpp
- * @brief Defines a class for parsing CSV files into a 2D vector of strings.
+ * @brief Defines a memory-mapped, streaming RFC 4180 CSV parser.
  */
+#pragma once
 
+#include <charconv>
+#include <cstddef>
+#include <iostream>
 #include <optional>
+#include <span>
 #include <string>
+#include <string_view>
+#include <tuple>
 #include <utility>
 #include <vector>
 
 /**
  * @class CsvParser
  * @brief A utility class to parse CSV files into a structured format.
+ *
+ * The file is memory-mapped and walked once. Cells are handed out as string views into the mapping; only quoted
+ * cells containing escaped quotes ("") are unescaped, into a scratch buffer reused across rows. Quoted cells may
+ * contain delimiters and line breaks, and their surrounding quotes are removed. Rows are delivered to a callback,
+ * so even files with hundreds of thousands of rows are parsed without per-cell allocations.
  */
 class CsvParser {
  private:
-    std::string file_path;  ///< The path to the CSV file to be parsed.
-    char delimiter;         ///< The delimiter used in the CSV file (default is ',').
+    std::string file_path;           ///< The path to the CSV file to be parsed.
+    char delimiter;                  ///< The delimiter used in the CSV file (default is ',').
+    const char* data = nullptr;      ///< Start of the mapped file.
+    size_t size = 0;                 ///< Size of the mapped file.
+    bool opened = false;             ///< Whether the file could be opened.
+    mutable std::vector<std::string_view> cells;  ///< Cells of the current row.
+    mutable std::string scratch;     ///< Backing store of the unescaped cells of the current row.
+    mutable std::vector<std::tuple<size_t, size_t, size_t>> unescaped;  ///< (cell, offset, length) in scratch.
+
+    /**
+     * @brief Splits the next row into cells.
+     * @param pos Offset of the row in the file. Advanced past the row.
+     * @param line Physical line of the row. Advanced by the line breaks the row consumed, quoted ones included.
+     * @return False once the end of the file is reached.
+     */
+    auto nextRow(size_t& pos, size_t& line) const -> bool;
+
+    /**
+     * @brief Parses a cell into a typed value.
+     * @param cell Cell text.
+     * @param out Destination.
+     * @return True if the whole cell was consumed.
+     */
+    static auto parseCell(std::string_view cell, std::string_view& out) -> bool {
+        out = cell;
+        return true;
+    }
+    template <typename T>
+    static auto parseCell(std::string_view cell, T& out) -> bool {
+        auto [ptr, ec] = std::from_chars(cell.data(), cell.data() + cell.size(), out);
+        return (ec == std::errc()) && (ptr == cell.data() + cell.size());
+    }
 
  public:
     /**
-     * @brief Constructs a CsvParser object.
+     * @brief Constructs a CsvParser object and maps the file.
      * @param file_path The path to the CSV file.
      * @param delimiter The delimiter used in the file (default is ',').
      */
-    CsvParser(std::string file_path, char delimiter = ',') : file_path(std::move(file_path)), delimiter(delimiter) {}
+    CsvParser(std::string file_path, char delimiter = ',');
+    CsvParser(const CsvParser&) = delete;
+    auto operator=(const CsvParser&) -> CsvParser& = delete;
+    ~CsvParser();
+
+    /**
+     * @brief Checks whether the file was opened.
+     * @return True if the file can be parsed.
+     */
+    [[nodiscard]] auto isOpen() const -> bool { return this->opened; }
+
+    /**
+     * @brief Calls a function for every non-empty row.
+     * @param f Callable as `bool f(std::span<const std::string_view> cells, size_t line)`, where line is the
+     *          physical line (from 1) the row starts on; returning false stops the parse. The views are only valid
+     *          during the call.
+     * @return True if every row was accepted.
+     */
+    template <typename F>
+    auto forEachRow(F&& f) const -> bool {
+        size_t pos = 0;
+        size_t next = 1;
+        for (size_t line = next; nextRow(pos, next); line = next) {
+            if ((this->cells.size() == 1) && this->cells[0].empty()) {
+                continue;
+            }
+            if (!f(std::span<const std::string_view>(this->cells), line)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Calls a function with the first cells of every row parsed as typed values.
+     * @tparam T Types of the leading cells: arithmetic types (parsed with std::from_chars) or std::string_view.
+     * @param f Callable as `void f(T... values)`; string views are only valid during the call.
+     * @return True if the file was opened and every row parsed; errors are reported on std::cerr.
+     */
+    template <typename... T, typename F>
+    auto forEachRecord(F&& f) const -> bool {
+        if (!this->opened) {
+            return false;
+        }
+        return forEachRow([&](std::span<const std::string_view> row, size_t line) {
+            if (row.size() < sizeof...(T)) {
+                std::cerr << "Error: " << this->file_path << ':' << line << ": Expected " << sizeof...(T)
+                          << " cells, got " << row.size() << '\n';
+                return false;
+            }
+            std::tuple<T...> values;
+            bool ok = [&]<size_t... I>(std::index_sequence<I...>) {
+                return (parseCell(row[I], std::get<I>(values)) && ...);
+            }(std::index_sequence_for<T...>{});
+            if (!ok) {
+                std::cerr << "Error: " << this->file_path << ':' << line << ": Invalid value\n";
+                return false;
+            }
+            std::apply(f, values);
+            return true;
+        });
+    }
 
     /**
      * @brief Parses the entire CSV file into a 2D vector of strings.
@@ -37,16 +140,10 @@ class CsvParser {
 int main() {
     CsvParser parser("../debt.csv");
 
-    // Parsing the CSV file using the parse method
-    if (auto data = parser.parse()) {
-        std::cout << "Parsed using parse():\n";
-        for (const auto& row : *data) {
-            for (const auto& cell : row) {
-                std::cout << cell << " ";
-            }
-            std::cout << '\n';
-        }
-    }
+    // Typed rows, without allocating per cell
+    parser.forEachRecord<double, int, std::string_view>([](double principal, int month, std::string_view id) {
+        std::println("{} {:.2f} {}", id, principal, month);
+    });
     return 0;
 }
 */
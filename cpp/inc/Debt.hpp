@@ -1,8 +1,13 @@
+#pragma once
+
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
 #include <print>
 #include <string>
+#include <string_view>
+
+#include "Ids.hpp"
 
 #define DEBT_DEBUG false
 /**
@@ -25,7 +30,7 @@ class Debt {
     PERIOD_E interestPeriod;       ///< Interest accrual period (monthly or yearly).
     int periods;                   ///< Number of payment periods that have elapsed.
     int periodTaken;               ///< The period when the debt starts requiring payments.
-    std::string id;  ///< Identifier for the debt (e.g., a loan number). -- debug & debt.csv clarity purposes only
+    Ids::Id id;  ///< Interned identifier for the debt (e.g., a loan number). -- debug & debt.csv clarity purposes only
 
     static constexpr double EPSILON = 0.1;  ///< Threshold for zero comparison.
 
@@ -36,11 +41,11 @@ class Debt {
      * @param p Principal amount.
      * @param r Annual interest rate.
      * @param i Interest accrual period (PERIOD_E).
-     * @param id Identifier for the debt.
+     * @param id Identifier for the debt, interned into Ids.
      * @param minimumMonthlyPayment Minimum payment amount per month.
      * @param periodTaken Period when debt starts requiring payments.
      */
-    Debt(double p, double r, PERIOD_E i, std::string id, double minimumMonthlyPayment, int periodTaken);
+    Debt(double p, double r, PERIOD_E i, std::string_view id, double minimumMonthlyPayment, int periodTaken);
     /**
      * @brief Gets the remaining principal amount.
      * @return Remaining principal or 0 if payment period has elapsed.
@@ -56,6 +61,12 @@ class Debt {
      * @brief Accrues interest for the current period.
      */
     void accrue();
+    /**
+     * @brief Advances the debt over k periods in which it only accrues and takes its forced minimum payment.
+     * @param k Number of periods to skip.
+     * @note The debt must not be paid off during those periods; the jump costs O(1) regardless of k.
+     */
+    void fastForward(int k);
     /**
      * @brief Makes a payment toward the debt.
      * @param payment Reference to the payment amount. Adjusted after the function.
@@ -110,6 +121,19 @@ class Debt {
      * @return Compounded total.
      */
     static auto compoundTotal(double principal, double rate, int periods) -> double;
+    /**
+     * @brief Calculates, in closed form, the principal after a run of periods that each accrue at their
+     * compounding boundary and then take a fixed payment.
+     * @param principal Principal before the run.
+     * @param growth Multiplier applied at each compounding boundary (1 + rate).
+     * @param interval Number of periods between compounding boundaries.
+     * @param payment Payment made every period, after accrual.
+     * @param first First period of the run.
+     * @param last Last period of the run (inclusive).
+     * @return Principal after period `last`.
+     */
+    static auto compoundRun(double principal, double growth, int interval, double payment, int first, int last)
+        -> double;
     /**
      * @brief Calculates the compounded interest over a number of periods.
      * @param principal Initial principal amount.
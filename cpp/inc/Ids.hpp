@@ -0,0 +1,34 @@
+/**
+ * @file Ids.hpp
+ * @brief Defines the process-wide table of interned debt identifiers.
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * @class Ids
+ * @brief Interns debt identifiers, so a Debt or Portfolio carries a 4-byte handle instead of its own string.
+ *
+ * Each distinct identifier is stored once for the life of the process; copying a debt or a portfolio never
+ * copies, or allocates for, its identifiers. Interning happens while parsing, so both calls take a lock.
+ */
+class Ids {
+ public:
+    using Id = uint32_t;  ///< Handle of an interned identifier.
+
+    /**
+     * @brief Interns an identifier.
+     * @param name Identifier.
+     * @return Its handle; equal names get equal handles.
+     */
+    static auto intern(std::string_view name) -> Id;
+    /**
+     * @brief Gets the identifier behind a handle.
+     * @param id Handle returned by intern().
+     * @return The identifier; the reference stays valid for the life of the process.
+     */
+    static auto name(Id id) -> const std::string&;
+};
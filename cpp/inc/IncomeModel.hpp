@@ -0,0 +1,83 @@
+/**
+ * @file IncomeModel.hpp
+ * @brief Defines the monthly payment model: a precomputed payment range per month plus optional income shocks.
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Sampler.hpp"
+#include "Scenario.hpp"
+
+/**
+ * @class IncomeModel
+ * @brief Payment range of every month of a scenario, and the payment draws of one trajectory.
+ *
+ * The range of month m is Scenario::getPayRange(m), which grows at every promotion, times every one-off raise
+ * taking effect by month m. It is tabulated once per scenario, so a draw is a table lookup plus a scaled uniform.
+ * Payments are drawn BLOCK months at a time. An optional shock cuts the payment to `shockFactor` of its draw for
+ * `shockMonths` months; it starts in any month outside a shock with probability `shockProbability`.
+ */
+class IncomeModel {
+ public:
+    static constexpr int HORIZON = 1200;  ///< Months tabulated; later months keep the range of the last one.
+    static constexpr int BLOCK = 16;      ///< Months of payments drawn at once.
+
+    using Payments = std::array<double, BLOCK>;  ///< Payments of one block of months.
+
+ private:
+    std::vector<double> low;        ///< Lower end of the payment range, per month.
+    std::vector<double> width;      ///< Width of the payment range, per month.
+    double shockProbability = 0.0;  ///< Probability of a shock starting in a month.
+    double shockFactor = 1.0;       ///< Fraction of the payment left during a shock.
+    int shockMonths = 0;            ///< Duration of a shock.
+
+ public:
+    IncomeModel() = default;
+
+    /**
+     * @brief Tabulates the payment ranges of a scenario.
+     * @param scenario Scenario defining the income.
+     */
+    explicit IncomeModel(const Scenario& scenario);
+
+    /**
+     * @brief Draws the payments of months [first, first + BLOCK) of a trajectory.
+     * @param sampler Payment draws of the trajectory, positioned at month first.
+     * @param first First month of the block.
+     * @param shock Remaining months of the current shock. Adjusted after the function.
+     * @param out Destination; the payment of month first + k is written to out[k].
+     */
+    void draw(Sampler& sampler, int first, int& shock, Payments& out) const {
+        for (int k = 0; k < BLOCK; k++) {
+            auto m = static_cast<size_t>(std::min(first + k, HORIZON - 1));
+            out[k] = this->low[m] + (this->width[m] * sampler.uniform());
+        }
+        if (this->shockProbability <= 0.0) {
+            return;
+        }
+        for (int k = 0; k < BLOCK; k++) {
+            if ((shock == 0) && (sampler.event(static_cast<uint64_t>(first + k)) < this->shockProbability)) {
+                shock = this->shockMonths;
+            }
+            if (shock > 0) {
+                out[k] *= this->shockFactor;
+                shock--;
+            }
+        }
+    }
+
+    /**
+     * @brief Gets the payment range of a month, without shocks.
+     * @param month Month of the trajectory, from 0.
+     * @return A pair representing the minimum and maximum payment amounts.
+     */
+    [[nodiscard]] auto getRange(int month) const -> std::pair<double, double> {
+        auto m = static_cast<size_t>(std::min(month, HORIZON - 1));
+        return {this->low[m], this->low[m] + this->width[m]};
+    }
+};
@@ -0,0 +1,229 @@
+/**
+ * @file Instrumentation.hpp
+ * @brief Defines optional per-thread counters and cycle timers of the simulation phases.
+ *
+ * Everything is gated by INSTRUMENT in flags.hpp: with it off, the macros below expand to nothing (or to the bare
+ * statement) and InstrumentedMutex is a plain std::mutex, so the hot path compiles exactly as without them.
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "flags.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+/**
+ * @class Instrumentation
+ * @brief Process-wide counters and per-phase timers, kept in one cache-line aligned slot per thread.
+ *
+ * Each thread updates only its own slot with relaxed loads and stores, so counting costs a few cycles and never
+ * bounces a cache line between cores. Slots are summed on demand; totals taken while threads run are approximate.
+ */
+class Instrumentation {
+ public:
+    /**
+     * @enum COUNTER_E
+     * @brief Event counted by the instrumentation.
+     */
+    using COUNTER_E = enum {
+        COUNTER_CHUNKS,        ///< Chunks taken from the Scheduler.
+        COUNTER_STEALS,        ///< Successful steals from another thread's deque.
+        COUNTER_LOCK_WAITS,    ///< Acquisitions of an InstrumentedMutex that found it held.
+        COUNTER_TRAJECTORIES,  ///< Trajectories simulated, over every cell.
+        COUNTER_MONTHS,        ///< Months simulated, over every cell.
+        COUNTER_ALLOCATIONS,   ///< Calls to the global operator new.
+        COUNTER_COUNT
+    };
+    /**
+     * @enum PHASE_E
+     * @brief Timed phase of the simulation.
+     */
+    using PHASE_E = enum {
+        PHASE_SCHEDULE,   ///< Scheduler::next, including steals.
+        PHASE_LOCK_WAIT,  ///< Blocked on a held InstrumentedMutex.
+        PHASE_COPY,       ///< Copying the portfolios of a profile into a worker.
+        PHASE_BATCH,      ///< BatchEngine::run.
+        PHASE_RESET,      ///< Portfolio::reset of a scalar trajectory.
+        PHASE_DRAW,       ///< Drawing a block of payments.
+        PHASE_ACCRUE,     ///< Portfolio::accrue.
+        PHASE_PAY,        ///< Forced and non-forced payments.
+        PHASE_RETIRE,     ///< Portfolio::retirePaidOff.
+        PHASE_STATS,      ///< Adding a chunk's results to the streaming statistics.
+        PHASE_SINK,       ///< ResultSink::write.
+        PHASE_COUNT
+    };
+
+    static constexpr unsigned int MAX_THREADS = 256;  ///< Slots; further threads share them and may lose counts.
+
+    /**
+     * @struct Totals
+     * @brief Sum of every slot.
+     */
+    struct Totals {
+        std::array<uint64_t, COUNTER_COUNT> counts{};  ///< Count of each event.
+        std::array<uint64_t, PHASE_COUNT> calls{};     ///< Number of timed sections of each phase.
+        std::array<uint64_t, PHASE_COUNT> cycles{};    ///< Cycles spent in each phase.
+        unsigned int threads = 0;                      ///< Threads that recorded anything.
+    };
+
+ private:
+    /**
+     * @struct Slot
+     * @brief Counters of one thread, on their own cache lines.
+     */
+    struct alignas(64) Slot {
+        std::array<std::atomic<uint64_t>, COUNTER_COUNT> counts{};  ///< Count of each event.
+        std::array<std::atomic<uint64_t>, PHASE_COUNT> calls{};     ///< Number of timed sections of each phase.
+        std::array<std::atomic<uint64_t>, PHASE_COUNT> cycles{};    ///< Cycles spent in each phase.
+    };
+
+    static std::array<Slot, MAX_THREADS> slots;  ///< One slot per thread, assigned on first use.
+    static std::atomic<unsigned int> used;        ///< Number of slots handed out.
+
+    /**
+     * @brief Gets the slot of the calling thread.
+     * @return The slot.
+     */
+    static auto slot() -> Slot& {
+        thread_local Slot& own = slots[used.fetch_add(1, std::memory_order_relaxed) % MAX_THREADS];
+        return own;
+    }
+    /**
+     * @brief Adds to a counter of the calling thread's slot.
+     * @param c Counter.
+     * @param n Amount to add.
+     */
+    static void bump(std::atomic<uint64_t>& c, uint64_t n) {
+        c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+ public:
+    /**
+     * @brief Reads the cycle counter (the TSC on x86, nanoseconds elsewhere).
+     * @return Current tick.
+     */
+    static auto now() -> uint64_t {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+    /**
+     * @brief Counts events on the calling thread.
+     * @param counter Event.
+     * @param n Number of events.
+     */
+    static void count(COUNTER_E counter, uint64_t n = 1) { bump(slot().counts[counter], n); }
+    /**
+     * @brief Records one timed section on the calling thread.
+     * @param phase Phase.
+     * @param cycles Cycles spent in the section.
+     */
+    static void time(PHASE_E phase, uint64_t cycles) {
+        Slot& s = slot();
+        bump(s.calls[phase], 1);
+        bump(s.cycles[phase], cycles);
+    }
+
+    /**
+     * @brief Sums the slots of every thread.
+     * @return Totals since the start of the process.
+     */
+    static auto totals() -> Totals;
+    /**
+     * @brief Formats the totals as a table: counters, then cycles per phase with their share and cost per call.
+     * @param totals Totals to format.
+     * @return Human-readable summary.
+     */
+    static auto toString(const Totals& totals) -> std::string;
+    /**
+     * @brief Formats the totals as a JSON object.
+     * @param totals Totals to format.
+     * @return JSON object with "counters" and "phases".
+     */
+    static auto toJson(const Totals& totals) -> std::string;
+    /**
+     * @brief Converts a counter to a string.
+     * @param counter Counter.
+     * @return Name of the counter.
+     */
+    static auto printCounter(COUNTER_E counter) -> std::string;
+    /**
+     * @brief Converts a phase to a string.
+     * @param phase Phase.
+     * @return Name of the phase.
+     */
+    static auto printPhase(PHASE_E phase) -> std::string;
+
+    /**
+     * @class Timer
+     * @brief Records the cycles between its construction and destruction as one section of a phase.
+     */
+    class Timer {
+     private:
+        PHASE_E phase;   ///< Phase being timed.
+        uint64_t start;  ///< Tick at construction.
+
+     public:
+        explicit Timer(PHASE_E phase) : phase(phase), start(now()) {}
+        ~Timer() { time(this->phase, now() - this->start); }
+        Timer(const Timer&) = delete;
+        auto operator=(const Timer&) -> Timer& = delete;
+    };
+
+    /**
+     * @class Mutex
+     * @brief std::mutex counting and timing the acquisitions that had to wait.
+     */
+    class Mutex : public std::mutex {
+     public:
+        void lock() {
+            if (try_lock()) {
+                return;
+            }
+            count(COUNTER_LOCK_WAITS);
+            Timer timer(PHASE_LOCK_WAIT);
+            std::mutex::lock();
+        }
+    };
+};
+
+#if (INSTRUMENT)
+using InstrumentedMutex = Instrumentation::Mutex;  ///< Mutex of the hot path, counting its contention.
+#define INSTRUMENT_CAT_(a, b) a##b
+#define INSTRUMENT_CAT(a, b) INSTRUMENT_CAT_(a, b)
+/**
+ * @macro INSTRUMENT_COUNT
+ * @brief Counts n events of an Instrumentation::COUNTER_E if INSTRUMENT is enabled.
+ */
+#define INSTRUMENT_COUNT(counter, n) Instrumentation::count(Instrumentation::counter, n)
+/**
+ * @macro INSTRUMENT_SCOPE
+ * @brief Times the rest of the enclosing scope as an Instrumentation::PHASE_E if INSTRUMENT is enabled.
+ */
+#define INSTRUMENT_SCOPE(phase) Instrumentation::Timer INSTRUMENT_CAT(instrumentTimer, __LINE__)(Instrumentation::phase)
+/**
+ * @macro INSTRUMENT_TIME
+ * @brief Runs a statement, timing it as an Instrumentation::PHASE_E if INSTRUMENT is enabled.
+ */
+#define INSTRUMENT_TIME(phase, ...)                                     \
+    do {                                                                \
+        Instrumentation::Timer instrumentTimer(Instrumentation::phase); \
+        __VA_ARGS__;                                                    \
+    } while (false)
+#else
+using InstrumentedMutex = std::mutex;
+#define INSTRUMENT_COUNT(counter, n)
+#define INSTRUMENT_SCOPE(phase)
+#define INSTRUMENT_TIME(phase, ...) __VA_ARGS__
+#endif
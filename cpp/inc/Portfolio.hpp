@@ -0,0 +1,174 @@
+/**
+ * @file Portfolio.hpp
+ * @brief Defines a structure-of-arrays debt portfolio used by the simulation hot loop.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "Debt.hpp"
+#include "Ids.hpp"
+#include "Strategy.hpp"
+
+/**
+ * @class Portfolio
+ * @brief Flat, contiguous representation of a set of debts plus the state of one trajectory through it.
+ *
+ * Debts are stored in the payment order of the strategy (see Strategy::order), so index order is payment order. The
+ * immutable parameters are built once from the parsed CSV; reset() restores the trajectory state with a memcpy
+ * instead of reconstructing Debt objects, and paid-off debts are retired by clearing their bit in `active`. The
+ * mask is one word, so a portfolio holds at most MAX_DEBTS debts and larger debt files are rejected.
+ */
+class Portfolio {
+ public:
+    static constexpr size_t MAX_DEBTS = 64;  ///< Capacity of the active bitmask.
+
+ private:
+    size_t count = 0;                       ///< Number of debts in the portfolio.
+    std::vector<double> initialPrincipal;   ///< Principal of each debt at the start of a trajectory.
+    std::vector<double> rate;               ///< Interest rate per compounding interval.
+    std::vector<double> growth;             ///< Multiplier per compounding interval (1 + rate), so accrual is one multiply.
+    std::vector<double> minimumPayment;     ///< Forced monthly payment (0 if not forced).
+    std::vector<int> periodTaken;           ///< Period when the debt starts requiring payments.
+    std::vector<int> compoundInterval;      ///< Number of periods between interest accruals.
+    std::vector<Ids::Id> ids;               ///< Interned debt identifiers -- debug & debt.csv clarity purposes only.
+    uint64_t forcedMask = 0;                ///< Bit set for every debt with a forced minimum payment.
+    uint64_t initialMask = 0;               ///< Bit set for every debt in the portfolio.
+    int kidIndex = -1;                      ///< Index of the "kid" debt, or -1 if there is none.
+
+    std::vector<double> principal;  ///< Remaining principal of each debt in the current trajectory.
+    std::vector<double> paid;       ///< Amount paid toward each debt in the current trajectory.
+    uint64_t active = 0;            ///< Bit set for every debt not yet paid off.
+    int periods = 0;                ///< Number of periods elapsed in the current trajectory.
+
+    /**
+     * @brief Makes a payment toward one debt, with the same semantics as Debt::pay.
+     * @param i Debt index.
+     * @param payment Reference to the payment amount. Adjusted after the function.
+     */
+    void pay(size_t i, double& payment);
+    /**
+     * @brief Fills the parameters from debts already in payment order.
+     * @param sorted Debts in payment order; at most MAX_DEBTS.
+     */
+    void build(const std::vector<Debt>& sorted);
+
+ public:
+    Portfolio() = default;
+
+    /**
+     * @brief Builds a portfolio from parsed debts.
+     * @param debts Debts to include; at most MAX_DEBTS.
+     * @param strategy Strategy selecting the payment order.
+     * @param hybridThreshold Largest balance paid snowball-style by Strategy::STRATEGY_HYBRID.
+     */
+    explicit Portfolio(const std::vector<Debt>& debts, Strategy::STRATEGY_E strategy = Strategy::STRATEGY_AVALANCHE,
+                       double hybridThreshold = 0.0);
+    /**
+     * @brief Builds a portfolio in the payment order of a custom strategy.
+     * @param debts Debts to include; at most MAX_DEBTS.
+     * @param less Payment order, see Strategy::order.
+     * @tparam O Type of the order.
+     */
+    template <DebtOrder O>
+    Portfolio(const std::vector<Debt>& debts, O less) {
+        std::vector<Debt> sorted = debts;
+        Strategy::order(sorted, less);
+        build(sorted);
+    }
+
+    /**
+     * @brief Restores the state of a fresh trajectory.
+     */
+    void reset();
+    /**
+     * @brief Accrues interest on every debt for the next period.
+     */
+    void accrue();
+    /**
+     * @brief Advances the trajectory over k periods in which debts only accrue and take their forced payments.
+     * @param k Number of periods to skip.
+     * @note No debt may be paid off during those periods; the jump costs O(1) per debt regardless of k.
+     */
+    void fastForward(int k);
+    /**
+     * @brief Pays the minimum on every forced debt that has been taken.
+     * @param payment Reference to the payment amount. Reduced by the forced payments when Aggressive.
+     * @tparam Aggressive Payments freed from paid-off forced debts go into the other debts.
+     */
+    template <bool Aggressive>
+    void payForced(double& payment);
+    /**
+     * @brief Pays non-forced debts in payment order, then forced debts early if money remains.
+     * @param payment Reference to the payment amount. Adjusted after the function.
+     * @tparam Proportional Split the payment in proportion to the balances instead of cascading it.
+     */
+    template <bool Proportional>
+    void payNonForced(double& payment);
+    /**
+     * @brief Gets the next period in which the structure of the portfolio changes whatever the payments: a debt is
+     * taken, or an active debt crosses a compounding boundary.
+     * @return The period, or INT_MAX if there is none; every period before it is a candidate for payQuiet().
+     */
+    [[nodiscard]] auto nextEvent() const -> int;
+    /**
+     * @brief Simulates a period in which nothing is paid off, so only the forced debts and the first taken debt in
+     * payment order change; equivalent to accrue(), payForced(), payNonForced() and retirePaidOff() in such a period.
+     * @param payment Payment of the period.
+     * @return False, leaving the portfolio unchanged, if some debt could be paid off in the period.
+     * @tparam Aggressive Payments freed from paid-off forced debts go into the other debts.
+     * @note The next period must come before nextEvent(), and the strategy must cascade payments.
+     */
+    template <bool Aggressive>
+    auto payQuiet(double payment) -> bool;
+    /**
+     * @brief Retires every debt whose principal reached zero.
+     * @param totalPaid Reference to the trajectory total. Increased by the amount paid toward each retired debt.
+     */
+    void retirePaidOff(double& totalPaid);
+
+    /**
+     * @brief Checks if the kid debt is the only one left.
+     * @return True if only the kid debt remains active.
+     */
+    [[nodiscard]] auto isOnlyKidLeft() const -> bool { return (this->kidIndex >= 0) && (this->active == (1ULL << this->kidIndex)); }
+    /**
+     * @brief Calculates the total remaining principal of the active, taken debts.
+     * @return Total debt amount.
+     */
+    [[nodiscard]] auto getTotalDebt() const -> double;
+    /**
+     * @brief Calculates the total paid toward the active, taken debts.
+     * @return Total paid amount.
+     */
+    [[nodiscard]] auto getTotalPaid() const -> double;
+    /**
+     * @brief Gets the remaining principal of one debt, as counted by getTotalDebt().
+     * @param i Debt index.
+     * @return Remaining principal, or 0 if the debt is paid off or not taken yet.
+     */
+    [[nodiscard]] auto getBalance(size_t i) const -> double {
+        return (((this->active >> i) & 1) != 0) && (this->periodTaken[i] <= this->periods) ? this->principal[i] : 0.0;
+    }
+    /**
+     * @brief Gets the number of debts in the portfolio.
+     * @return Number of debts.
+     */
+    [[nodiscard]] auto size() const -> size_t { return this->count; }
+
+    // Immutable parameters of each debt in payment order, read by the batch kernels and the checks of a sweep
+    [[nodiscard]] auto getInitialPrincipal() const -> std::span<const double> { return this->initialPrincipal; }
+    [[nodiscard]] auto getRate() const -> std::span<const double> { return this->rate; }
+    [[nodiscard]] auto getGrowth() const -> std::span<const double> { return this->growth; }
+    [[nodiscard]] auto getMinimumPayment() const -> std::span<const double> { return this->minimumPayment; }
+    [[nodiscard]] auto getPeriodTaken() const -> std::span<const int> { return this->periodTaken; }
+    [[nodiscard]] auto getCompoundInterval() const -> std::span<const int> { return this->compoundInterval; }
+    [[nodiscard]] auto getIds() const -> std::span<const Ids::Id> { return this->ids; }
+    [[nodiscard]] auto getForcedMask() const -> uint64_t { return this->forcedMask; }
+    [[nodiscard]] auto getInitialMask() const -> uint64_t { return this->initialMask; }
+    [[nodiscard]] auto getKidIndex() const -> int { return this->kidIndex; }
+};
@@ -0,0 +1,39 @@
+/**
+ * @file Profile.hpp
+ * @brief Defines a client profile: one debt file and the sweep of scenarios simulated on it.
+ */
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Config.hpp"
+#include "Debt.hpp"
+#include "Sweep.hpp"
+
+/**
+ * @struct Profile
+ * @brief A parsed debt file with its cells, shared read-only by every worker.
+ *
+ * In batch mode (`--portfolios`) every profile gets its own statistics. All profiles use the same random streams,
+ * like the cells of a sweep, but differences are only reported between cells of one profile.
+ */
+struct Profile {
+    std::string name;  ///< Label of the profile in the output.
+    Sweep sweep;       ///< Cells simulated on this profile's debts.
+
+    /**
+     * @brief Loads the profiles of a run: the single debt file, or every portfolio of a batch.
+     * @param config Configuration naming the debt file or the batch (a directory of .csv files or a manifest
+     *               listing one path per line, relative to the manifest).
+     * @return The profiles, or std::nullopt if a file cannot be read or parsed.
+     */
+    static auto loadAll(const Config& config) -> std::optional<std::vector<Profile>>;
+    /**
+     * @brief Parses a debt file.
+     * @param path Path of the debt file.
+     * @return Debts with yearly rates, or std::nullopt if the file cannot be read or parsed.
+     */
+    static auto loadDebts(const std::string& path) -> std::optional<std::vector<Debt>>;
+};
@@ -0,0 +1,38 @@
+/**
+ * @file Report.hpp
+ * @brief Defines the native aggregation of result files written with --write-results (`finances report`).
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Statistics.hpp"
+#include "ThreadPool.hpp"
+
+/**
+ * @class Report
+ * @brief Summarizes result files, text or binary, by parsing pieces of every file on every thread of a pool.
+ *
+ * Files are mapped, not read. A CSV file is cut into pieces of about PIECE_BYTES at line boundaries and a binary
+ * file into pieces of PIECE_ROWS rows; threads take pieces from a shared counter. As in simulate(), the moments of
+ * each piece are kept apart and folded in piece order while the histograms and sketches are merged per thread, so
+ * the summary does not depend on the number of threads.
+ */
+class Report {
+ public:
+    static constexpr size_t PIECE_BYTES = 4 << 20;    ///< Bytes of CSV text parsed as one piece.
+    static constexpr uint64_t PIECE_ROWS = 1 << 19;  ///< Rows of a binary file parsed as one piece.
+
+    /**
+     * @brief Summarizes result files.
+     * @param paths Result files: simulations.bin as written by BinaryResultSink, or "totalPaid,periods" lines.
+     * @param pool Threads to parse on.
+     * @return The summary of each file, or std::nullopt if a file cannot be read.
+     */
+    static auto summarize(const std::vector<std::string>& paths, ThreadPool& pool)
+        -> std::optional<std::vector<ResultStats>>;
+};
@@ -0,0 +1,168 @@
+/**
+ * @file ResultSink.hpp
+ * @brief Defines destinations for per-trajectory results: an indexed columnar binary file and a text CSV.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+
+#include "Instrumentation.hpp"
+#include "TrajectoryResult.hpp"
+
+/**
+ * @class ResultSink
+ * @brief Destination for the results of every simulated trajectory.
+ */
+class ResultSink {
+ public:
+    virtual ~ResultSink() = default;
+
+    /**
+     * @brief Writes the results of consecutive iterations. Safe to call concurrently from several workers.
+     * @param first Global index of results[0].
+     * @param results Results to write.
+     */
+    virtual void write(uint64_t first, std::span<const TrajectoryResult> results) = 0;
+    /**
+     * @brief Finishes the output once every result has been written.
+     * @return True on success.
+     */
+    virtual auto close() -> bool { return true; }
+};
+
+/**
+ * @struct ResultFileHeader
+ * @brief Header of a binary results file. Columns follow at the given byte offsets, then the index.
+ */
+struct ResultFileHeader {
+    static constexpr uint64_t MAGIC = 0x32305345524E4946ULL;  ///< "FINRES02" read as a little-endian uint64.
+
+    uint64_t magic = MAGIC;      ///< Identifies the file format.
+    uint64_t count = 0;          ///< Number of rows.
+    uint64_t paidOffset = 0;     ///< Byte offset of the float64 totalPaid column.
+    uint64_t periodsOffset = 0;  ///< Byte offset of the uint16 periods column.
+    uint64_t groups = 1;         ///< Profiles; profile g owns rows [g * count / groups, (g + 1) * count / groups).
+    uint64_t maxPeriods = 0;     ///< Largest periods value, which sizes the periods histograms of the index.
+    uint64_t indexOffset = 0;    ///< Byte offset of one ResultGroupIndex per profile (0 until the sink is closed).
+};
+
+/**
+ * @struct ResultGroupIndex
+ * @brief Index of the rows of one profile: summary moments and sorted copies of its columns.
+ *
+ * `sortedPaid` answers totalPaid percentiles in O(1) and P(totalPaid < x) in O(log n). `byPeriods` holds totalPaid
+ * sorted by (periods, totalPaid) and `cumulative[m]` counts the rows with periods < m, so the rows with periods in
+ * [a, b] are the positions [cumulative[a], cumulative[b + 1]) of `byPeriods`; `prefix` holds its running sums.
+ */
+struct ResultGroupIndex {
+    double paidMean = 0.0;            ///< Mean totalPaid.
+    double paidStd = 0.0;             ///< Standard deviation of totalPaid.
+    double periodsMean = 0.0;         ///< Mean periods.
+    double periodsStd = 0.0;          ///< Standard deviation of periods.
+    uint64_t sortedPaidOffset = 0;    ///< Byte offset of the float64 totalPaid column, ascending.
+    uint64_t byPeriodsOffset = 0;     ///< Byte offset of the float64 totalPaid column, by (periods, totalPaid).
+    uint64_t prefixOffset = 0;        ///< Byte offset of the float64 running sums of byPeriods (rows + 1 values).
+    uint64_t cumulativeOffset = 0;    ///< Byte offset of the uint64 rows with fewer periods (maxPeriods + 2 values).
+};
+
+/**
+ * @class BinaryResultSink
+ * @brief Writes results into a preallocated columnar file (float64 totalPaid, uint16 periods) and indexes them.
+ *
+ * Row i lives at a fixed offset in each column, so workers pwrite their chunks straight into disjoint regions of
+ * the one output file: no locking, no per-row flush and no concatenation pass. close() appends the index read by
+ * ResultStore, or fails if any write did.
+ */
+class BinaryResultSink : public ResultSink {
+ private:
+    int fd;                           ///< File descriptor of the output file.
+    ResultFileHeader header;          ///< Layout of the output file.
+    std::atomic<bool> failed{false};  ///< Set by a write that could not be stored; close() then fails.
+
+    /**
+     * @brief Constructs a BinaryResultSink around an open, preallocated file.
+     * @param fd File descriptor of the output file.
+     * @param header Layout of the output file.
+     */
+    BinaryResultSink(int fd, ResultFileHeader header) : fd(fd), header(header) {}
+
+ public:
+    BinaryResultSink(const BinaryResultSink&) = delete;
+    auto operator=(const BinaryResultSink&) -> BinaryResultSink& = delete;
+    ~BinaryResultSink() override;
+
+    /**
+     * @brief Creates the output file and preallocates room for every row.
+     * @param path Path of the output file.
+     * @param iterations Number of rows that will be written per profile.
+     * @param groups Number of profiles.
+     * @return The sink, or nullptr if the file cannot be created.
+     */
+    static auto open(const std::string& path, uint64_t iterations, uint64_t groups = 1)
+        -> std::unique_ptr<BinaryResultSink>;
+
+    /**
+     * @brief Writes the results of consecutive iterations into their slots of each column.
+     * @param first Global index of results[0].
+     * @param results Results to write; periods must fit the uint16 column.
+     */
+    void write(uint64_t first, std::span<const TrajectoryResult> results) override;
+    /**
+     * @brief Sorts the columns of each profile and appends the index, then publishes it in the header.
+     * @return True on success, false if a write failed or the index cannot be written.
+     */
+    auto close() -> bool override;
+
+    /**
+     * @brief Converts a binary results file to the text CSV format ("totalPaid,periods" per line).
+     * @param binaryPath Path of the binary results file.
+     * @param csvPath Path of the CSV file to write.
+     * @return True on success.
+     */
+    static auto exportCsv(const std::string& binaryPath, const std::string& csvPath) -> bool;
+};
+
+/**
+ * @class CsvResultSink
+ * @brief Writes results as "totalPaid,periods" text lines, one buffered block per call.
+ *
+ * Blocks are appended in completion order, so the order of the rows depends on the thread count; the binary sink
+ * keeps every row at its index.
+ */
+class CsvResultSink : public ResultSink {
+ private:
+    std::string path;         ///< Path of the output file.
+    std::ofstream file;       ///< Output file.
+    InstrumentedMutex mutex;  ///< Serializes blocks from concurrent workers.
+
+ public:
+    /**
+     * @brief Constructs a CsvResultSink.
+     * @param path Path of the output file.
+     */
+    explicit CsvResultSink(const std::string& path) : path(path), file(path, std::ios_base::binary) {}
+
+    /**
+     * @brief Checks whether the output file was opened.
+     * @return True if the sink can be written to.
+     */
+    [[nodiscard]] auto isOpen() const -> bool { return this->file.is_open(); }
+
+    /**
+     * @brief Formats the results into one block and appends it to the file.
+     * @param first Global index of results[0] (unused; blocks are appended in completion order).
+     * @param results Results to write.
+     */
+    void write(uint64_t first, std::span<const TrajectoryResult> results) override;
+    /**
+     * @brief Flushes and closes the output file.
+     * @return True if every block was written.
+     */
+    auto close() -> bool override;
+};
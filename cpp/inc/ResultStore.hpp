@@ -0,0 +1,147 @@
+/**
+ * @file ResultStore.hpp
+ * @brief Defines a read-only, memory-mapped view of an indexed binary results file.
+ */
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <utility>
+
+#include "ResultSink.hpp"
+
+/**
+ * @struct PeriodRange
+ * @brief Inclusive range of payoff periods a query is restricted to.
+ */
+struct PeriodRange {
+    uint64_t lo = 0;           ///< Fewest periods.
+    uint64_t hi = UINT64_MAX;  ///< Most periods.
+};
+
+/**
+ * @class ResultStore
+ * @brief Answers moment, percentile and probability queries from the index written by BinaryResultSink::close().
+ *
+ * Nothing is parsed or copied: the file is mapped and every query reads a few entries of the sorted columns. Queries
+ * may be restricted to the rows whose periods fall in a PeriodRange; the rows of one periods value are contiguous
+ * and sorted by totalPaid, so such queries cost O(log n) per periods value of the range instead of O(n).
+ */
+class ResultStore {
+ private:
+    const uint8_t* base;      ///< Mapped file.
+    size_t size;              ///< Size of the mapping in bytes.
+    ResultFileHeader header;  ///< Layout of the file.
+
+    /**
+     * @brief Constructs a ResultStore around a mapped file.
+     * @param base Mapped file.
+     * @param size Size of the mapping in bytes.
+     */
+    ResultStore(const uint8_t* base, size_t size);
+
+    /**
+     * @brief Gets a column of the file.
+     * @param offset Byte offset of the column.
+     * @param count Number of values.
+     * @return The column.
+     * @tparam T Type of the values.
+     */
+    template <class T>
+    [[nodiscard]] auto column(uint64_t offset, uint64_t count) const -> std::span<const T> {
+        return {reinterpret_cast<const T*>(this->base + offset), count};
+    }
+    /**
+     * @brief Gets the cumulative counts of a profile (see ResultGroupIndex).
+     * @param group Profile.
+     * @return maxPeriods + 2 counts.
+     */
+    [[nodiscard]] auto cumulative(uint64_t group) const -> std::span<const uint64_t> {
+        return column<uint64_t>(summary(group).cumulativeOffset, this->header.maxPeriods + 2);
+    }
+    /**
+     * @brief Clamps a periods range to the periods values of the file.
+     * @param range Periods range.
+     * @return First periods value and one past the last, both in [0, maxPeriods + 1].
+     */
+    [[nodiscard]] auto clamp(PeriodRange range) const -> std::pair<uint64_t, uint64_t>;
+
+ public:
+    ResultStore(const ResultStore&) = delete;
+    auto operator=(const ResultStore&) -> ResultStore& = delete;
+    ~ResultStore();
+
+    /**
+     * @brief Maps a results file.
+     * @param path Path of the file written by BinaryResultSink.
+     * @return The store, or nullptr if the file cannot be read or was never indexed.
+     */
+    static auto open(const std::string& path) -> std::unique_ptr<ResultStore>;
+
+    [[nodiscard]] auto groups() const -> uint64_t { return this->header.groups; }
+    [[nodiscard]] auto rows() const -> uint64_t { return this->header.count / this->header.groups; }
+    /**
+     * @brief Gets the index of a profile, with its moments over every row.
+     * @param group Profile.
+     * @return The index.
+     */
+    [[nodiscard]] auto summary(uint64_t group) const -> const ResultGroupIndex& {
+        return column<ResultGroupIndex>(this->header.indexOffset, this->header.groups)[group];
+    }
+
+    /**
+     * @brief Counts the rows of a periods range. O(1).
+     * @param group Profile.
+     * @param range Periods range.
+     * @return Number of rows.
+     */
+    [[nodiscard]] auto count(uint64_t group, PeriodRange range = {}) const -> uint64_t;
+    /**
+     * @brief Gets the mean totalPaid of a periods range. O(1).
+     * @param group Profile.
+     * @param range Periods range.
+     * @return Mean totalPaid (0 if the range is empty).
+     */
+    [[nodiscard]] auto paidMean(uint64_t group, PeriodRange range = {}) const -> double;
+    /**
+     * @brief Gets the nearest-rank quantile of totalPaid. O(1), or O(log^2 n) per periods value of a range.
+     * @param group Profile.
+     * @param q Quantile in [0, 1].
+     * @param range Periods range.
+     * @return The quantile (0 if the range is empty).
+     */
+    [[nodiscard]] auto paidQuantile(uint64_t group, double q, PeriodRange range = {}) const -> double;
+    /**
+     * @brief Gets the fraction of rows with totalPaid below a value. O(log n) per periods value of the range.
+     * @param group Profile.
+     * @param x Threshold.
+     * @param range Periods range.
+     * @return P(totalPaid < x) within the range (0 if the range is empty).
+     */
+    [[nodiscard]] auto paidBelow(uint64_t group, double x, PeriodRange range = {}) const -> double;
+    /**
+     * @brief Gets the mean periods of a periods range. O(1), or O(1) per periods value of the range.
+     * @param group Profile.
+     * @param range Periods range.
+     * @return Mean periods (0 if the range is empty).
+     */
+    [[nodiscard]] auto periodsMean(uint64_t group, PeriodRange range = {}) const -> double;
+    /**
+     * @brief Gets the nearest-rank quantile of periods. O(log m) for m distinct periods values.
+     * @param group Profile.
+     * @param q Quantile in [0, 1].
+     * @param range Periods range.
+     * @return The quantile (0 if the range is empty).
+     */
+    [[nodiscard]] auto periodsQuantile(uint64_t group, double q, PeriodRange range = {}) const -> uint64_t;
+    /**
+     * @brief Gets the fraction of rows paid off in fewer than a number of periods. O(1).
+     * @param group Profile.
+     * @param n Threshold.
+     * @param range Periods range.
+     * @return P(periods < n) within the range (0 if the range is empty).
+     */
+    [[nodiscard]] auto periodsBelow(uint64_t group, uint64_t n, PeriodRange range = {}) const -> double;
+};
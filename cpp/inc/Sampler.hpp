@@ -0,0 +1,169 @@
+/**
+ * @file Sampler.hpp
+ * @brief Defines the source of the monthly payment draws, with optional variance reduction.
+ */
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "CounterRng.hpp"
+
+/**
+ * @class Sampler
+ * @brief Uniform draws of one trajectory, where draw d is the payment of month d.
+ *
+ * Plain Monte Carlo draws every month independently from the CounterRng. The other modes spread a block's
+ * trajectories more evenly over the unit cube while keeping every single draw uniform, so means stay unbiased:
+ *  - antithetic: trajectory 2k + 1 replays trajectory 2k with every u replaced by 1 - u;
+ *  - halton: month d of trajectory i is the i-th point of the base-prime(d) van der Corput sequence, randomly
+ *    shifted per block (Cranley-Patterson rotation), so every block is an independent randomized QMC replicate;
+ *  - stratified: every group of STRATA consecutive trajectories is a Latin hypercube, i.e. each of them falls
+ *    into a different 1/STRATA slice in month d, with an independent random assignment per month.
+ * Halton and stratified only cover the first `months` draws; later months fall back to plain draws.
+ */
+class Sampler {
+ public:
+    /**
+     * @enum MODE_E
+     * @brief Sampling scheme of the payment draws.
+     */
+    using MODE_E = enum { MODE_PLAIN, MODE_ANTITHETIC, MODE_HALTON, MODE_STRATIFIED, MODE_COUNT };
+
+    static constexpr int MAX_MONTHS = 64;      ///< Most months covered by halton or stratified sampling.
+    static constexpr uint64_t STRATA = 1024;   ///< Trajectories per Latin hypercube (power of two).
+    static constexpr uint64_t EVENTS = 1ULL << 32;  ///< First draw index of the event stream.
+
+ private:
+    /// Halton base of each month.
+    static constexpr std::array<uint64_t, MAX_MONTHS> PRIMES = {
+        2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53,
+        59, 61, 67, 71, 73, 79, 83, 89, 97, 101, 103, 107, 109, 113, 127, 131,
+        137, 139, 149, 151, 157, 163, 167, 173, 179, 181, 191, 193, 197, 199, 211, 223,
+        227, 229, 233, 239, 241, 251, 257, 263, 269, 271, 277, 281, 283, 293, 307, 311};
+
+    CounterRng rng;                          ///< Plain draws of the current trajectory.
+    CounterRng layout;                       ///< Random shifts and permutations of the current block.
+    MODE_E mode;                             ///< Sampling scheme.
+    int months;                              ///< Months covered by halton or stratified sampling.
+    uint64_t trajectory = 0;                 ///< Index of the current trajectory within the block.
+    uint64_t month = 0;                      ///< Index of the next draw.
+    std::array<double, MAX_MONTHS> shift{};  ///< Halton: random shift of each month.
+
+    /**
+     * @brief Radical inverse of i in a prime base (the i-th point of the van der Corput sequence).
+     * @param base Prime base.
+     * @param i Point index.
+     * @return Point in [0, 1).
+     */
+    static auto radicalInverse(uint64_t base, uint64_t i) -> double {
+        double inverse = 1.0 / static_cast<double>(base);
+        double scale = inverse;
+        double res = 0.0;
+        while (i != 0) {
+            res += static_cast<double>(i % base) * scale;
+            i /= base;
+            scale *= inverse;
+        }
+        return res;
+    }
+
+    /**
+     * @brief Keyed bijection of [0, STRATA), assigning the trajectories of a group to strata.
+     * @param x Position of the trajectory within its group.
+     * @param key Random key of the group and month.
+     * @return Stratum of the trajectory.
+     */
+    static auto permute(uint64_t x, uint64_t key) -> uint64_t {
+        constexpr uint64_t MASK = STRATA - 1;
+        constexpr int HALF = std::countr_zero(STRATA) / 2;
+        // Odd multipliers, additions and right xor-shifts are all invertible modulo a power of two
+        for (int round = 0; round < 3; round++) {
+            x = ((x * ((key & MASK) | 1)) + (key >> 32)) & MASK;
+            x ^= x >> HALF;
+            key = (key >> 11) | (key << 53);
+        }
+        return x;
+    }
+
+ public:
+    /**
+     * @brief Constructs a Sampler positioned at the first trajectory of a block.
+     * @param seed Global seed of the run.
+     * @param stream Block, selecting the random stream and the randomization of the sequences.
+     * @param mode Sampling scheme.
+     * @param months Months covered by halton or stratified sampling, at most MAX_MONTHS.
+     */
+    Sampler(uint64_t seed, uint64_t stream, MODE_E mode = MODE_PLAIN, int months = 0);
+
+    /**
+     * @brief Moves to the first draw of a trajectory.
+     * @param i Trajectory (iteration) index within the block.
+     */
+    void seek(uint64_t i) {
+        this->trajectory = i;
+        this->month = 0;
+        // Both trajectories of an antithetic pair read the same stream
+        this->rng.seek((this->mode == MODE_ANTITHETIC) ? (i >> 1) : i);
+    }
+
+    /**
+     * @brief Next uniform double in [0, 1).
+     * @return Uniform sample.
+     */
+    auto uniform() -> double {
+        uint64_t d = this->month++;
+        double u = CounterRng::toUniform(this->rng.at(d));
+        if (this->mode == MODE_PLAIN) [[likely]] {
+            return u;
+        }
+        if (this->mode == MODE_ANTITHETIC) {
+            // 1 - u lies in (0, 1] instead of [0, 1), which is just as uniform
+            return ((this->trajectory & 1) != 0) ? 1.0 - u : u;
+        }
+        if (d >= static_cast<uint64_t>(this->months)) {
+            return u;
+        }
+        if (this->mode == MODE_HALTON) {
+            double x = radicalInverse(PRIMES[d], this->trajectory) + this->shift[d];
+            return (x >= 1.0) ? x - 1.0 : x;
+        }
+        uint64_t group = this->trajectory / STRATA;
+        uint64_t stratum = permute(this->trajectory % STRATA, this->layout.at((group * MAX_MONTHS) + d));
+        return (static_cast<double>(stratum) + u) / static_cast<double>(STRATA);
+    }
+
+    /**
+     * @brief Next uniform double in [lo, hi).
+     * @param lo Lower bound.
+     * @param hi Upper bound.
+     * @return Uniform sample.
+     */
+    auto uniform(double lo, double hi) -> double { return lo + ((hi - lo) * uniform()); }
+
+    /**
+     * @brief Plain uniform draw of a month's random event (e.g. an income shock), independent of the payments.
+     * @param d Month.
+     * @return Uniform sample in [0, 1).
+     */
+    [[nodiscard]] auto event(uint64_t d) const -> double { return CounterRng::toUniform(this->rng.at(EVENTS + d)); }
+
+    [[nodiscard]] auto getMode() const -> MODE_E { return this->mode; }
+
+    /**
+     * @brief Parses a sampling scheme name.
+     * @param s Name (plain, antithetic, halton or stratified).
+     * @return The scheme, or std::nullopt if unknown.
+     */
+    static auto fromString(std::string_view s) -> std::optional<MODE_E>;
+    /**
+     * @brief Converts a sampling scheme to a string.
+     * @param mode Scheme.
+     * @return String representation of the scheme.
+     */
+    static auto printMode(MODE_E mode) -> std::string;
+};
@@ -0,0 +1,47 @@
+/**
+ * @file Scenario.hpp
+ * @brief Defines the parameters of one simulated scenario.
+ */
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Strategy.hpp"
+
+/**
+ * @struct Scenario
+ * @brief Payment policy and income parameters fed into the simulation engine.
+ */
+struct Scenario {
+    bool kid = true;                    ///< Specifies if the simulation involves having a child.
+    bool aggressive = true;             ///< Put payments freed from paid off required debts into other debts.
+    double aggressiveOffset = 475.0;    ///< Sum of monthly required payments, added to the payment range if aggressive.
+    uint64_t iterations = 1024 * 1024;  ///< Number of trajectories to simulate.
+    double paymentMin = 2000.0;         ///< Minimum monthly payment before the aggressive offset.
+    double paymentMax = 3000.0;         ///< Maximum monthly payment before the aggressive offset.
+    double paymentExtra = 0.0;          ///< Extra amount added to both ends of the payment range.
+    double paymentGrowthRate = 0.5;     ///< Multiplier on payment range after promotion.
+    int paymentGrowthFrequency = 36;    ///< Promotion or job change cadence (in periods).
+    std::vector<std::pair<int, double>> raises;  ///< One-off (month, multiplier) changes of the payment range.
+    double shockProbability = 0.0;      ///< Probability of an income shock starting in a month.
+    double shockFactor = 0.5;           ///< Fraction of the payment left during a shock.
+    int shockMonths = 6;                ///< Duration of an income shock (in periods).
+    Strategy::STRATEGY_E strategy = Strategy::STRATEGY_AVALANCHE;  ///< Payoff strategy.
+    double hybridThreshold = 1000.0;    ///< Largest balance paid snowball-style by the hybrid strategy.
+    int maxPeriods = 1200;              ///< Periods after which a trajectory with debt left is stopped (capped).
+
+    /**
+     * @brief Calculates a range of payment amounts based on the simulation period.
+     * @param periods The current number of periods elapsed.
+     * @return A pair representing the minimum and maximum payment amounts.
+     */
+    [[nodiscard]] auto getPayRange(int periods) const -> std::pair<double, double>;
+    /**
+     * @brief Checks the options that constrain each other, which Config::set sees one at a time.
+     * @return True if the payment range is ordered and starts at a non-negative payment; errors are reported on
+     * std::cerr.
+     */
+    [[nodiscard]] auto validate() const -> bool;
+};
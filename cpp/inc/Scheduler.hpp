@@ -0,0 +1,99 @@
+/**
+ * @file Scheduler.hpp
+ * @brief Defines a chunked work-stealing scheduler handing iterations out to the worker threads.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "Instrumentation.hpp"
+
+/**
+ * @struct Chunk
+ * @brief Iterations [begin, end) of one block of one group; the unit of work handed to a thread.
+ */
+struct Chunk {
+    size_t group;    ///< Group (profile) the iterations belong to.
+    uint64_t block;  ///< Block, selecting the random stream.
+    int begin;       ///< First iteration within the block.
+    int end;         ///< One past the last iteration within the block.
+    uint64_t first;  ///< Global index of the first iteration (position in the result file), counted across groups.
+    size_t index;    ///< Position of the chunk in the round, independent of the thread running it.
+};
+
+/**
+ * @class Scheduler
+ * @brief Splits an exact iteration count into chunks and balances them over threads by work stealing.
+ *
+ * Every group (profile) runs the same iterations. They are split into blocks whose sizes differ by at most one, so
+ * no remainder is dropped, and every block into chunks of at most `chunkSize` iterations. A shard of a run split
+ * across processes only gets the chunks of its own contiguous range of blocks. Each thread owns a deque holding a contiguous run of
+ * chunk indices: it takes chunks from the front, and an idle thread steals the back half of the fullest other
+ * deque. Trajectory lengths vary a lot, so a static split leaves cores idle through the tail.
+ */
+class Scheduler {
+ private:
+    /**
+     * @struct Deque
+     * @brief Chunk indices [front, back) owned by one thread, on its own cache line.
+     */
+    struct alignas(64) Deque {
+        InstrumentedMutex mutex;  ///< Guards front and back.
+        uint64_t front = 0;       ///< Next chunk the owner takes.
+        uint64_t back = 0;        ///< One past the last chunk.
+    };
+
+    std::vector<Chunk> chunks;                ///< Every chunk of the run, block by block.
+    std::unique_ptr<Deque[]> deques;          ///< One deque per thread.
+    unsigned int threads;                     ///< Number of deques.
+
+ public:
+    /**
+     * @brief Constructs a Scheduler.
+     * @param iterations Exact number of iterations to hand out (in total, counting earlier rounds).
+     * @param blocks Number of blocks (random streams) the iterations are split into.
+     * @param threads Number of threads taking chunks.
+     * @param chunkSize Maximum number of iterations per chunk.
+     * @param groups Number of groups running the iterations.
+     * @param done Iterations already simulated by an earlier round; every block resumes after its share of them.
+     * @param shard Shard whose blocks are handed out, in [0, shards).
+     * @param shards Number of shards the blocks are split into; at most `blocks`.
+     */
+    Scheduler(uint64_t iterations, uint64_t blocks, unsigned int threads, int chunkSize, size_t groups = 1,
+              uint64_t done = 0, uint64_t shard = 0, uint64_t shards = 1);
+
+    /**
+     * @brief Takes the next chunk for a thread, stealing from another thread once its own deque is empty.
+     * @param thread Index of the calling thread.
+     * @return The chunk, or std::nullopt once every chunk has been handed out.
+     */
+    auto next(unsigned int thread) -> std::optional<Chunk>;
+
+    [[nodiscard]] auto getChunks() const -> const std::vector<Chunk>& { return this->chunks; }
+
+    /**
+     * @brief Gets the number of iterations of a block.
+     * @param iterations Total number of iterations.
+     * @param blocks Number of blocks.
+     * @param block Block index.
+     * @return Number of iterations in the block.
+     */
+    static auto blockSize(uint64_t iterations, uint64_t blocks, uint64_t block) -> uint64_t {
+        return (iterations / blocks) + ((block < (iterations % blocks)) ? 1 : 0);
+    }
+    /**
+     * @brief Gets the first block of a shard; shard k owns blocks [firstBlock(k), firstBlock(k + 1)).
+     * @param blocks Number of blocks.
+     * @param shards Number of shards.
+     * @param shard Shard index, in [0, shards].
+     * @return Index of the shard's first block.
+     */
+    static auto firstBlock(uint64_t blocks, uint64_t shards, uint64_t shard) -> uint64_t {
+        return (blocks * shard) / shards;
+    }
+};
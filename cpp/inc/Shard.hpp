@@ -0,0 +1,60 @@
+/**
+ * @file Shard.hpp
+ * @brief Defines the partial results of a run split across processes (`--shard K/N`, `finances merge`).
+ */
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Simulation.hpp"
+
+/**
+ * @struct ShardFileHeader
+ * @brief Header of a shard file. The recorded options follow, then the statistics of every cell of every profile.
+ */
+struct ShardFileHeader {
+    static constexpr uint64_t MAGIC = 0x31304448534E4946ULL;  ///< "FINSHD01" read as a little-endian uint64.
+
+    uint64_t magic = MAGIC;    ///< Identifies the file format.
+    uint64_t seed = 0;         ///< Seed of the run.
+    uint64_t iterations = 0;   ///< Iterations per cell of the whole run.
+    uint64_t blocks = 0;       ///< Blocks the whole run is split into.
+    uint64_t shard = 0;        ///< Shard of this file, in [0, shards).
+    uint64_t shards = 1;       ///< Number of shards of the run.
+    uint64_t groups = 0;       ///< Profiles.
+    uint64_t optionsSize = 0;  ///< Bytes of the options the run was configured with (see Config::options).
+    uint64_t statsSize = 0;    ///< Bytes of the statistics.
+};
+
+/**
+ * @class Shard
+ * @brief Writes the partial results of one shard and merges the shards of a run into the results of the whole run.
+ *
+ * Shard k of N simulates a contiguous range of the run's blocks, each on the same random stream it has in an
+ * unsharded run. Its file holds the moments of each of those blocks and the histograms and sketches of the shard,
+ * all saved losslessly. Merging copies every block's moments into place and folds them in block order, as
+ * simulate() does, and adds up the integer counts, so the merged results are bit-identical to those of one
+ * process running the whole seeded run, whatever the number of shards.
+ */
+class Shard {
+ public:
+    /**
+     * @brief Writes the results of a shard.
+     * @param path Path of the shard file.
+     * @param res Results of simulate() run with Options::shard and Options::shards.
+     * @param options Options of the run, which every shard of it must share (see Config::options).
+     * @return True on success.
+     */
+    static auto write(const std::string& path, const Results& res, const std::string& options) -> bool;
+    /**
+     * @brief Merges every shard of a run.
+     * @param paths Shard files, one per shard, in any order.
+     * @param options Set to the options of the run.
+     * @return The results of the whole run, or std::nullopt if a file cannot be read or the shards do not make up
+     * one run.
+     */
+    static auto merge(const std::vector<std::string>& paths, std::string& options) -> std::optional<Results>;
+};
@@ -0,0 +1,102 @@
+/**
+ * @file Simulation.hpp
+ * @brief Defines the library entry point: simulate profiles or a single portfolio and get their statistics.
+ */
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "Config.hpp"
+#include "Portfolio.hpp"
+#include "Profile.hpp"
+#include "ResultSink.hpp"
+#include "Sampler.hpp"
+#include "Scenario.hpp"
+#include "Statistics.hpp"
+#include "ThreadPool.hpp"
+#include "TrajectoryRecorder.hpp"
+
+/**
+ * @struct Options
+ * @brief How to run a simulation: threads, random streams, stopping rule and raw output. Everything is injectable.
+ */
+struct Options {
+    uint64_t seed = randomSeed();    ///< Seed every random stream is derived from.
+    ThreadPool* pool = nullptr;      ///< Threads to run on; nullptr starts `threads` threads for this call only.
+    unsigned int threads = 0;        ///< Threads started without a pool (0 = hardware concurrency).
+    bool simd = true;                ///< Advances several trajectories per vector lane (see BatchEngine).
+    bool events = false;             ///< Skips the quiet periods between events instead (see Worker::simulateEvents).
+    Sampler::MODE_E sampling = Sampler::MODE_PLAIN;  ///< Sampling scheme of the payment draws.
+    int samplingMonths = 24;         ///< Months covered by halton or stratified sampling.
+    unsigned int blocks = 64;        ///< Random streams the iterations are split into; fixed, unlike the thread count.
+    unsigned int shard = 0;          ///< Shard of the blocks to simulate, in [0, shards) (see Shard).
+    unsigned int shards = 1;         ///< Number of processes the blocks are split between; at most the block count.
+    unsigned int replicates = 16;    ///< Least number of blocks when sampling is not plain.
+    double targetCi = 0.0;           ///< Stop once every CI half-width is below this fraction of its mean (0 = off).
+    double confidence = 0.95;        ///< Confidence level of the targetCi intervals.
+    uint64_t minIterations = 16384;  ///< Size of the first round when targetCi is set.
+    ResultSink* sink = nullptr;      ///< Destination of the raw results of each profile's first cell (optional).
+    TrajectoryRecorder* recorder = nullptr;  ///< Destination of the sampled trajectories of each first cell (optional).
+
+    /**
+     * @brief Draws a seed from the system's entropy source.
+     * @return Random seed.
+     */
+    static auto randomSeed() -> uint64_t;
+    /**
+     * @brief Takes the run options of a command-line configuration.
+     * @param config Configuration.
+     * @return Options with the configured (or a random) seed and no pool, sink or recorder.
+     */
+    static auto fromConfig(const Config& config) -> Options;
+};
+
+/**
+ * @struct ProfileResults
+ * @brief Statistics of every cell of one profile.
+ */
+struct ProfileResults {
+    std::vector<ResultStats> stats;            ///< Summary of each cell.
+    std::vector<DeltaStats> deltas;            ///< Difference of each cell to the first cell.
+    std::vector<ReplicateStats> replicates;    ///< Moments of each block, per cell.
+
+    /**
+     * @brief Recomputes the moments of the stats and deltas of every cell from its blocks, in block order.
+     */
+    void fold();
+};
+
+/**
+ * @struct Results
+ * @brief Outcome of a simulation.
+ */
+struct Results {
+    uint64_t seed = 0;                     ///< Seed the run was simulated with; reproduces it with any thread count.
+    uint64_t iterations = 0;               ///< Iterations simulated per cell.
+    unsigned int blocks = 0;               ///< Independent random streams the iterations were split into.
+    unsigned int shard = 0;                ///< Shard whose blocks were simulated, in [0, shards).
+    unsigned int shards = 1;               ///< Number of shards; with more than one only the shard's blocks are set.
+    double widestHalfWidth = 0.0;          ///< Largest relative CI half-width over every mean (see Adaptive).
+    std::vector<ProfileResults> profiles;  ///< Statistics of each profile, in input order.
+};
+
+/**
+ * @brief Simulates every cell of every profile on common random numbers.
+ * @param profiles Profiles to simulate.
+ * @param iterations Iterations per cell; the cap when options.targetCi is set.
+ * @param options How to run the simulation.
+ * @return The statistics, or std::nullopt if the options are inconsistent.
+ */
+auto simulate(const std::vector<Profile>& profiles, uint64_t iterations, const Options& options)
+    -> std::optional<Results>;
+
+/**
+ * @brief Simulates one portfolio under one scenario.
+ * @param portfolio Debts to simulate, ordered by the scenario's strategy.
+ * @param scenario Scenario to simulate; its iterations are the iteration count.
+ * @param options How to run the simulation.
+ * @return The statistics of the single cell, or std::nullopt if the options are inconsistent.
+ */
+auto simulate(const Portfolio& portfolio, const Scenario& scenario, const Options& options) -> std::optional<Results>;
@@ -0,0 +1,392 @@
+/**
+ * @file Statistics.hpp
+ * @brief Defines mergeable streaming statistics: moments, fixed-bin histograms and quantile sketches.
+ *
+ * Every accumulator can be saved to and loaded from a binary buffer, losslessly, so statistics gathered by separate
+ * processes merge exactly as if one process had gathered them (see Shard).
+ */
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "TrajectoryResult.hpp"
+
+/**
+ * @brief Quotes a string for JSON, escaping quotes, backslashes and control characters.
+ * @param s String to quote.
+ * @return JSON string literal, with the surrounding quotes.
+ */
+auto jsonString(std::string_view s) -> std::string;
+
+/**
+ * @class RunningStats
+ * @brief Welford accumulator for count, mean, variance, min and max.
+ */
+class RunningStats {
+ private:
+    uint64_t n = 0;                                       ///< Number of samples.
+    double mu = 0.0;                                      ///< Running mean.
+    double m2 = 0.0;                                      ///< Sum of squared deviations from the mean.
+    double lo = std::numeric_limits<double>::infinity();  ///< Smallest sample.
+    double hi = -std::numeric_limits<double>::infinity(); ///< Largest sample.
+
+ public:
+    /**
+     * @brief Adds a sample.
+     * @param x Sample value.
+     */
+    void add(double x) {
+        this->n++;
+        double d = x - this->mu;
+        this->mu += d / static_cast<double>(this->n);
+        this->m2 += d * (x - this->mu);
+        this->lo = std::min(this->lo, x);
+        this->hi = std::max(this->hi, x);
+    }
+    /**
+     * @brief Merges another accumulator into this one (Chan et al. pairwise update).
+     * @param o Accumulator to merge.
+     */
+    void merge(const RunningStats& o);
+    /**
+     * @brief Appends the accumulator to a binary buffer.
+     * @param out Destination.
+     */
+    void save(std::string& out) const;
+    /**
+     * @brief Reads an accumulator written by save().
+     * @param in Source. Advanced past the accumulator.
+     * @return True on success; false if the buffer is truncated.
+     */
+    auto load(std::string_view& in) -> bool;
+
+    [[nodiscard]] auto count() const -> uint64_t { return this->n; }
+    [[nodiscard]] auto mean() const -> double { return this->mu; }
+    /**
+     * @brief Gets the sample variance (n - 1 denominator).
+     * @return Sample variance, or 0 with fewer than two samples.
+     */
+    [[nodiscard]] auto variance() const -> double {
+        return (this->n > 1) ? (this->m2 / static_cast<double>(this->n - 1)) : 0.0;
+    }
+    [[nodiscard]] auto stddev() const -> double { return std::sqrt(variance()); }
+    [[nodiscard]] auto min() const -> double { return this->lo; }
+    [[nodiscard]] auto max() const -> double { return this->hi; }
+};
+
+/**
+ * @class Histogram
+ * @brief Fixed-width bins anchored at zero; grows to cover whatever range is observed.
+ */
+class Histogram {
+ private:
+    double width;                 ///< Width of each bin.
+    int64_t offset = 0;           ///< Bin index of counts[0].
+    std::vector<uint64_t> counts; ///< Number of samples per bin.
+    uint64_t n = 0;               ///< Number of samples.
+
+    /**
+     * @brief Makes sure bins [first, last] exist.
+     * @param first Lowest bin index needed.
+     * @param last Highest bin index needed.
+     */
+    void cover(int64_t first, int64_t last);
+
+ public:
+    /**
+     * @brief Constructs an empty Histogram.
+     * @param width Width of each bin.
+     */
+    explicit Histogram(double width) : width(width) {}
+
+    /**
+     * @brief Adds a sample.
+     * @param x Sample value.
+     */
+    void add(double x) {
+        auto bin = static_cast<int64_t>(std::floor(x / this->width));
+        cover(bin, bin);
+        this->counts[bin - this->offset]++;
+        this->n++;
+    }
+    /**
+     * @brief Merges another histogram with the same bin width into this one.
+     * @param o Histogram to merge.
+     */
+    void merge(const Histogram& o);
+    /**
+     * @brief Appends the histogram to a binary buffer.
+     * @param out Destination.
+     */
+    void save(std::string& out) const;
+    /**
+     * @brief Reads a histogram written by save(), bin width included.
+     * @param in Source. Advanced past the histogram.
+     * @return True on success; false if the buffer is truncated or inconsistent.
+     */
+    auto load(std::string_view& in) -> bool;
+    /**
+     * @brief Gets the nearest-rank quantile, reported as the lower edge of its bin.
+     * @param q Quantile in [0, 1].
+     * @return Quantile value; exact for integer data with unit bins.
+     */
+    [[nodiscard]] auto quantile(double q) const -> double;
+
+    [[nodiscard]] auto count() const -> uint64_t { return this->n; }
+    [[nodiscard]] auto getWidth() const -> double { return this->width; }
+    [[nodiscard]] auto getStart() const -> double { return static_cast<double>(this->offset) * this->width; }
+    [[nodiscard]] auto getCounts() const -> const std::vector<uint64_t>& { return this->counts; }
+};
+
+/**
+ * @class QuantileSketch
+ * @brief Log-bucketed quantile sketch (DDSketch-style) with bounded relative error; merging is exact.
+ *
+ * Totals paid vary by well under 1% between trajectories, so the default accuracy of 0.01% (about $18 at $180k)
+ * still resolves the percentiles. Buckets are only allocated across the observed range and at most MAX_BUCKETS are
+ * kept, a factor of about 5 at the default accuracy; as in DDSketch's collapsing store, samples further below the
+ * largest one are counted in the lowest kept bucket. A sample's bucket then only
+ * depends on the largest sample, so merges stay exact in any order.
+ */
+class QuantileSketch {
+ public:
+    static constexpr int64_t MAX_BUCKETS = 8192;  ///< Buckets kept per sketch (64 KiB of counts).
+
+ private:
+    double gamma;                 ///< Ratio between consecutive bucket bounds.
+    double logGamma;              ///< log(gamma).
+    int64_t offset = 0;           ///< Bucket index of counts[0].
+    std::vector<uint64_t> counts; ///< Number of positive samples per bucket; the last bucket holds the largest.
+    uint64_t nonPositive = 0;     ///< Number of samples <= 0.
+    uint64_t n = 0;               ///< Number of samples.
+
+    /**
+     * @brief Moves the counts to buckets [low, high], counting the buckets below low in low.
+     * @param low New lowest bucket.
+     * @param high New highest bucket; at least the current one.
+     */
+    void rebase(int64_t low, int64_t high);
+
+ public:
+    /**
+     * @brief Constructs an empty QuantileSketch.
+     * @param relativeAccuracy Maximum relative error of reported quantiles.
+     */
+    explicit QuantileSketch(double relativeAccuracy = 1e-4);
+
+    /**
+     * @brief Adds a sample.
+     * @param x Sample value.
+     */
+    void add(double x);
+    /**
+     * @brief Merges another sketch with the same accuracy into this one.
+     * @param o Sketch to merge.
+     */
+    void merge(const QuantileSketch& o);
+    /**
+     * @brief Appends the sketch to a binary buffer.
+     * @param out Destination.
+     */
+    void save(std::string& out) const;
+    /**
+     * @brief Reads a sketch written by save(), accuracy included.
+     * @param in Source. Advanced past the sketch.
+     * @return True on success; false if the buffer is truncated or inconsistent.
+     */
+    auto load(std::string_view& in) -> bool;
+    /**
+     * @brief Gets the nearest-rank quantile.
+     * @param q Quantile in [0, 1].
+     * @return Quantile value, within the relative accuracy for positive samples.
+     */
+    [[nodiscard]] auto quantile(double q) const -> double;
+
+    [[nodiscard]] auto count() const -> uint64_t { return this->n; }
+};
+
+/**
+ * @class ResultStats
+ * @brief Streaming summary of trajectory results: moments, histograms and P50/P90/P99 of totalPaid and periods.
+ */
+class ResultStats {
+ public:
+    static constexpr double PAID_BIN_WIDTH = 100.0;  ///< Histogram bin width for totalPaid (USD).
+
+    RunningStats paid;          ///< Moments of totalPaid.
+    RunningStats periods;       ///< Moments of payoff periods.
+    Histogram paidHistogram;    ///< Histogram of totalPaid.
+    Histogram periodsHistogram; ///< Histogram of payoff periods, one bin per period (exact quantiles).
+    QuantileSketch paidSketch;  ///< Quantiles of totalPaid.
+    uint64_t capped = 0;        ///< Trajectories stopped at the period cap with debt left (included above).
+
+    ResultStats() : paidHistogram(PAID_BIN_WIDTH), periodsHistogram(1.0) {}
+
+    /**
+     * @brief Adds the outcome of one trajectory.
+     * @param r Trajectory result.
+     */
+    void add(const TrajectoryResult& r) {
+        this->paid.add(r.totalPaid);
+        this->periods.add(static_cast<double>(r.periods));
+        addCounts(r);
+    }
+    /**
+     * @brief Adds the outcome of one trajectory to the histograms and the sketch only, whose merges are exact.
+     * @param r Trajectory result.
+     */
+    void addCounts(const TrajectoryResult& r) {
+        this->paidHistogram.add(r.totalPaid);
+        this->periodsHistogram.add(static_cast<double>(r.periods));
+        this->paidSketch.add(r.totalPaid);
+        this->capped += r.capped ? 1 : 0;
+    }
+    /**
+     * @brief Merges another summary into this one.
+     * @param o Summary to merge.
+     */
+    void merge(const ResultStats& o);
+    /**
+     * @brief Appends the summary to a binary buffer.
+     * @param out Destination.
+     */
+    void save(std::string& out) const;
+    /**
+     * @brief Reads a summary written by save().
+     * @param in Source. Advanced past the summary.
+     * @return True on success; false if the buffer is truncated or inconsistent.
+     */
+    auto load(std::string_view& in) -> bool;
+    /**
+     * @brief Prints the summary line ("name mean +- std in mean +- std months") followed by the percentiles, and the
+     * number of capped trajectories if there are any.
+     * @param name Label printed at the start of the line.
+     */
+    void print(const std::string& name) const;
+    /**
+     * @brief Serializes the summary as a small JSON document.
+     * @return JSON text.
+     */
+    [[nodiscard]] auto toJson() const -> std::string;
+};
+
+/**
+ * @class DeltaStats
+ * @brief Moments of the per-trajectory difference between a scenario and a baseline run on the same random numbers.
+ *
+ * Both runs see the same payments, so the spread of the difference is far below the spread of either run.
+ */
+class DeltaStats {
+ public:
+    RunningStats paid;     ///< Moments of the difference in totalPaid.
+    RunningStats periods;  ///< Moments of the difference in payoff periods.
+
+    /**
+     * @brief Adds the outcomes of one trajectory under both scenarios.
+     * @param base Result under the baseline.
+     * @param r Result under the compared scenario.
+     */
+    void add(const TrajectoryResult& base, const TrajectoryResult& r) {
+        this->paid.add(r.totalPaid - base.totalPaid);
+        this->periods.add(static_cast<double>(r.periods - base.periods));
+    }
+    /**
+     * @brief Merges another accumulator into this one.
+     * @param o Accumulator to merge.
+     */
+    void merge(const DeltaStats& o) {
+        this->paid.merge(o.paid);
+        this->periods.merge(o.periods);
+    }
+};
+
+/**
+ * @class ReplicateStats
+ * @brief Moments of the results of each block, which are independent replicates of the whole run.
+ *
+ * Variance-reduced sampling makes the trajectories of a block dependent, so the spread of single trajectories no
+ * longer measures how precise a mean is; the spread between the block means still does. The moments of a whole run
+ * are folded from these in block order, so they do not depend on how the blocks were split between processes.
+ */
+class ReplicateStats {
+ public:
+    std::vector<RunningStats> paid;     ///< Moments of totalPaid, per block.
+    std::vector<RunningStats> periods;  ///< Moments of payoff periods, per block.
+    std::vector<DeltaStats> deltas;     ///< Difference to the first cell of the profile, per block.
+
+    /**
+     * @brief Adds the outcome of one trajectory.
+     * @param block Block the trajectory belongs to.
+     * @param r Trajectory result.
+     */
+    void add(uint64_t block, const TrajectoryResult& r) {
+        if (block >= this->paid.size()) {
+            this->paid.resize(block + 1);
+            this->periods.resize(block + 1);
+            this->deltas.resize(block + 1);
+        }
+        this->paid[block].add(r.totalPaid);
+        this->periods[block].add(static_cast<double>(r.periods));
+    }
+    /**
+     * @brief Merges another accumulator into this one.
+     * @param o Accumulator to merge.
+     */
+    void merge(const ReplicateStats& o);
+    /**
+     * @brief Merges the moments of part of one block.
+     * @param block Block the trajectories belong to.
+     * @param p Moments of their totalPaid.
+     * @param m Moments of their payoff periods.
+     * @param d Moments of their difference to the first cell.
+     */
+    void merge(uint64_t block, const RunningStats& p, const RunningStats& m, const DeltaStats& d) {
+        if (block >= this->paid.size()) {
+            this->paid.resize(block + 1);
+            this->periods.resize(block + 1);
+            this->deltas.resize(block + 1);
+        }
+        this->paid[block].merge(p);
+        this->periods[block].merge(m);
+        this->deltas[block].merge(d);
+    }
+    /**
+     * @brief Appends the moments of every block to a binary buffer.
+     * @param out Destination.
+     */
+    void save(std::string& out) const;
+    /**
+     * @brief Reads moments written by save().
+     * @param in Source. Advanced past the moments.
+     * @return True on success; false if the buffer is truncated or inconsistent.
+     */
+    auto load(std::string_view& in) -> bool;
+    /**
+     * @brief Gets the variance reduction factor of a mean: the variance plain Monte Carlo would have with the same
+     * number of trajectories, divided by the variance measured between the blocks.
+     * @param blocks Moments of each block.
+     * @return Variance reduction factor (1 for plain Monte Carlo, in expectation), or 1 with fewer than two blocks
+     * or a constant sample.
+     */
+    static auto varianceReduction(const std::vector<RunningStats>& blocks) -> double;
+};
+
+/**
+ * @struct ChunkStats
+ * @brief Moments of one cell over one chunk of iterations.
+ *
+ * Floating-point merges are not associative, so moments merged per thread would depend on which thread ran which
+ * chunk. Workers record the moments of every chunk instead, and they are folded in chunk order once a round is done;
+ * histograms and sketches only hold integer counts, so their per-thread merges are exact.
+ */
+struct ChunkStats {
+    RunningStats paid;     ///< Moments of totalPaid.
+    RunningStats periods;  ///< Moments of payoff periods.
+    DeltaStats delta;      ///< Difference to the first cell of the profile.
+};
@@ -0,0 +1,128 @@
+/**
+ * @file Strategy.hpp
+ * @brief Defines the payoff strategies: the order debts are paid in and how extra money is allocated.
+ */
+#pragma once
+
+#include <algorithm>
+#include <concepts>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Debt.hpp"
+
+/**
+ * @brief Payment order of a custom strategy: a strict weak order on debts, the first debt is paid first.
+ * @tparam O Type of the order.
+ */
+template <class O>
+concept DebtOrder = std::strict_weak_order<O&, const Debt&, const Debt&>;
+
+/**
+ * @class Strategy
+ * @brief Payoff strategy of a scenario.
+ *
+ * A strategy is made of two parts. The payment order is a permutation applied once when the Portfolio is built,
+ * so it costs nothing per month. The allocation of the extra payment (cascade in order, or split in proportion to
+ * the balances) is a compile-time policy of the month loop, see Policy.
+ *
+ * A custom strategy supplies its own payment order as a DebtOrder, builds its Portfolio with it and runs through
+ * Sweep::single; its scenario's strategy then only selects the allocation. Allocation rules other than cascade and
+ * proportional are not pluggable, as each has hand-written lane kernels in BatchEngine.
+ */
+class Strategy {
+ public:
+    /**
+     * @enum STRATEGY_E
+     * @brief Supported strategies.
+     */
+    using STRATEGY_E = enum {
+        STRATEGY_AVALANCHE,     ///< Highest interest rate first.
+        STRATEGY_SNOWBALL,      ///< Smallest balance first.
+        STRATEGY_PROPORTIONAL,  ///< Split in proportion to the balances; surplus cascades in rate order.
+        STRATEGY_HYBRID,        ///< Balances up to a threshold smallest first, then highest rate first.
+        STRATEGY_COUNT
+    };
+
+    /**
+     * @brief Sorts debts into the payment order of a strategy.
+     * @param debts Debts to sort.
+     * @param strategy Strategy.
+     * @param hybridThreshold Largest balance paid snowball-style by STRATEGY_HYBRID.
+     */
+    static void order(std::vector<Debt>& debts, STRATEGY_E strategy, double hybridThreshold);
+    /**
+     * @brief Sorts debts into a custom payment order.
+     * @param debts Debts to sort.
+     * @param less Strict weak order; debts it holds equivalent stay in decreasing interest rate order.
+     * @tparam O Type of the order.
+     */
+    template <DebtOrder O>
+    static void order(std::vector<Debt>& debts, O less) {
+        std::ranges::sort(debts, std::ranges::greater(), &Debt::rate);
+        std::ranges::stable_sort(debts, less);
+    }
+    /**
+     * @brief Checks if a strategy splits the extra payment across debts instead of cascading it.
+     * @param strategy Strategy.
+     * @return True if the strategy splits the payment.
+     */
+    static auto isProportional(STRATEGY_E strategy) -> bool { return strategy == STRATEGY_PROPORTIONAL; }
+    /**
+     * @brief Parses a strategy name.
+     * @param name Name of the strategy.
+     * @return Strategy, or std::nullopt if the name is unknown.
+     */
+    static auto fromString(std::string_view name) -> std::optional<STRATEGY_E>;
+    /**
+     * @brief Converts a strategy to a string.
+     * @param strategy Strategy.
+     * @return String representation of the strategy.
+     */
+    static auto printStrategy(STRATEGY_E strategy) -> std::string;
+};
+
+/**
+ * @brief Compile-time switches of the month loop, as held by Policy.
+ * @tparam P Type of the policy.
+ */
+template <class P>
+concept PaymentPolicy = std::same_as<decltype(P::aggressive), const bool> &&
+                        std::same_as<decltype(P::kid), const bool> &&
+                        std::same_as<decltype(P::proportional), const bool>;
+
+/**
+ * @struct Policy
+ * @brief Compile-time switches of the month loop, so it stays free of per-month branching on the scenario.
+ * @tparam Aggressive Payments freed from paid-off forced debts go into the other debts.
+ * @tparam Kid Trajectories end once only the kid debt is left.
+ * @tparam Proportional The extra payment is split in proportion to the balances instead of cascading.
+ */
+template <bool Aggressive, bool Kid, bool Proportional>
+struct Policy {
+    static constexpr bool aggressive = Aggressive;      ///< See Scenario::aggressive.
+    static constexpr bool kid = Kid;                    ///< See Scenario::kid.
+    static constexpr bool proportional = Proportional;  ///< See Strategy::isProportional.
+};
+static_assert(PaymentPolicy<Policy<true, false, true>>);
+
+/**
+ * @brief Calls `f.template operator()<P>()` with the Policy matching runtime switches.
+ * @param aggressive Payments freed from paid-off forced debts go into the other debts.
+ * @param kid Trajectories end once only the kid debt is left.
+ * @param proportional The extra payment is split in proportion to the balances.
+ * @param f Generic lambda taking the policy as template parameter.
+ */
+template <class F>
+void withPolicy(bool aggressive, bool kid, bool proportional, F&& f) {
+    auto withKid = [&]<bool A>() {
+        auto withProportional = [&]<bool K>() {
+            proportional ? f.template operator()<Policy<A, K, true>>() : f.template operator()<Policy<A, K, false>>();
+        };
+        kid ? withProportional.template operator()<true>() : withProportional.template operator()<false>();
+    };
+    aggressive ? withKid.template operator()<true>() : withKid.template operator()<false>();
+}
@@ -0,0 +1,75 @@
+/**
+ * @file Sweep.hpp
+ * @brief Defines a grid of scenarios evaluated together on common random numbers.
+ */
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Config.hpp"
+#include "Debt.hpp"
+#include "IncomeModel.hpp"
+#include "Portfolio.hpp"
+#include "Scenario.hpp"
+#include "Statistics.hpp"
+
+/**
+ * @struct Cell
+ * @brief One point of the grid: a scenario, its income model and the portfolio it is simulated on.
+ */
+struct Cell {
+    std::vector<std::string> values;  ///< Value of each sweep axis for this cell.
+    Scenario scenario;                ///< Scenario of this cell.
+    IncomeModel income;               ///< Payment ranges of this cell's scenario.
+    Portfolio portfolio;              ///< Debts of this cell.
+};
+
+/**
+ * @class Sweep
+ * @brief Cartesian product of the sweep axes of a Config.
+ *
+ * Every cell is simulated on the same trajectories (same random payments), so the difference between a cell and
+ * the first cell has a far lower variance than the difference of two independent runs. Without axes the sweep has
+ * a single cell, the plain run.
+ */
+class Sweep {
+ private:
+    std::vector<std::string> keys;  ///< Name of each sweep axis.
+    std::vector<Cell> cells;        ///< Cells in row-major order of the axes; cells[0] is the baseline.
+
+ public:
+    /**
+     * @brief Expands the sweep axes of a configuration.
+     * @param config Configuration holding the base scenario and the axes.
+     * @param debts Parsed debts, before conversion to monthly rates.
+     * @return The sweep, or std::nullopt if an axis is invalid or the payments of a cell cannot cover its interest.
+     */
+    static auto build(const Config& config, const std::vector<Debt>& debts) -> std::optional<Sweep>;
+    /**
+     * @brief Builds a sweep without axes, the plain run of one scenario.
+     * @param scenario Scenario to simulate.
+     * @param portfolio Debts to simulate, ordered by the scenario's strategy.
+     * @return The sweep, with a single cell.
+     */
+    static auto single(const Scenario& scenario, const Portfolio& portfolio) -> Sweep;
+
+    [[nodiscard]] auto getKeys() const -> const std::vector<std::string>& { return this->keys; }
+    [[nodiscard]] auto getCells() const -> const std::vector<Cell>& { return this->cells; }
+
+    /**
+     * @brief Prints one row per cell with its statistics and its difference to the first cell.
+     * @param stats Statistics of each cell.
+     * @param deltas Difference of each cell to the first cell.
+     */
+    void printTable(const std::vector<ResultStats>& stats, const std::vector<DeltaStats>& deltas) const;
+    /**
+     * @brief Serializes the statistics of every cell as a JSON array.
+     * @param stats Statistics of each cell.
+     * @param deltas Difference of each cell to the first cell.
+     * @return JSON text.
+     */
+    [[nodiscard]] auto toJson(const std::vector<ResultStats>& stats, const std::vector<DeltaStats>& deltas) const
+        -> std::string;
+};
@@ -0,0 +1,59 @@
+/**
+ * @file ThreadPool.hpp
+ * @brief Defines a fixed pool of threads that stay alive between simulations.
+ */
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @class ThreadPool
+ * @brief Runs one task on every thread of the pool at a time and waits for all of them.
+ *
+ * Threads are started once and sleep between tasks, so an embedding service can keep a warm pool across many
+ * simulate() calls instead of spawning threads per request. Calls to run() from several threads are serialized.
+ */
+class ThreadPool {
+ private:
+    std::vector<std::thread> threads;                         ///< Pool threads.
+    std::mutex runMutex;                                      ///< Serializes run() calls.
+    std::mutex mutex;                                         ///< Guards the fields below.
+    std::condition_variable wake;                             ///< Signals a new task or shutdown to the threads.
+    std::condition_variable finished;                         ///< Signals the end of a task to run().
+    const std::function<void(unsigned int)>* task = nullptr;  ///< Current task.
+    uint64_t generation = 0;                                  ///< Number of tasks started so far.
+    unsigned int running = 0;                                 ///< Threads still working on the current task.
+    bool stopping = false;                                    ///< Set by the destructor.
+
+    /**
+     * @brief Body of a pool thread: waits for tasks and runs them until shutdown.
+     * @param index Index of the thread, passed to every task.
+     */
+    void loop(unsigned int index);
+
+ public:
+    /**
+     * @brief Starts the pool threads.
+     * @param size Number of threads; 0 means one per hardware thread.
+     */
+    explicit ThreadPool(unsigned int size = 0);
+    /**
+     * @brief Stops and joins the pool threads.
+     */
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    auto operator=(const ThreadPool&) -> ThreadPool& = delete;
+
+    /**
+     * @brief Runs task(i) on every pool thread i and returns once all of them have returned.
+     * @param task Task to run.
+     */
+    void run(const std::function<void(unsigned int)>& task);
+
+    [[nodiscard]] auto size() const -> unsigned int { return static_cast<unsigned int>(this->threads.size()); }
+};
@@ -0,0 +1,169 @@
+/**
+ * @file TrajectoryRecorder.hpp
+ * @brief Defines an opt-in recorder of the month-by-month debt balances of sampled trajectories.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Portfolio.hpp"
+#include "Profile.hpp"
+
+/**
+ * @struct TrajectoryFileHeader
+ * @brief Header of a trajectory file. Chunks follow it back to back up to the profile table.
+ */
+struct TrajectoryFileHeader {
+    static constexpr uint64_t MAGIC = 0x31304A52544E4946ULL;  ///< "FINTRJ01" read as a little-endian uint64.
+
+    uint64_t magic = MAGIC;    ///< Identifies the file format.
+    uint64_t scale = 100;      ///< Fixed-point units per dollar of the stored balances.
+    uint64_t every = 0;        ///< Iterations i of each block with i % every == 0 were recorded.
+    uint64_t chunks = 0;       ///< Number of chunks.
+    uint64_t trajectories = 0; ///< Number of recorded trajectories.
+    uint64_t tableOffset = 0;  ///< Byte offset of the profile table, which ends the chunks.
+    uint64_t tableSize = 0;    ///< Size of the profile table in bytes.
+};
+
+/**
+ * @struct TrajectoryChunkHeader
+ * @brief Header of one chunk: `trajectories` entries, then the encoded balances, padded to 8 bytes.
+ */
+struct TrajectoryChunkHeader {
+    uint64_t trajectories = 0;  ///< Number of entries.
+    uint64_t valuesSize = 0;    ///< Size of the encoded balances in bytes, padding included.
+};
+
+/**
+ * @struct TrajectoryEntry
+ * @brief One recorded trajectory; its balances are at `offset` within the chunk's encoded balances.
+ */
+struct TrajectoryEntry {
+    uint32_t profile = 0;    ///< Profile index; its debt names are in the profile table.
+    uint32_t block = 0;      ///< Block of the trajectory.
+    uint32_t iteration = 0;  ///< Iteration within the block.
+    uint32_t months = 0;     ///< Months simulated.
+    uint32_t debts = 0;      ///< Debts of the portfolio, in payment order.
+    uint32_t reserved = 0;   ///< Padding.
+    uint64_t offset = 0;     ///< Byte offset of the encoded balances.
+    double totalPaid = 0.0;  ///< Outcome of the trajectory.
+};
+
+/**
+ * @class TrajectoryRecorder
+ * @brief Appends sampled trajectories to one file in delta-encoded, fixed-point columnar chunks.
+ *
+ * The balances of a trajectory are stored debt by debt, each debt as one column of `months` values: the balance at
+ * the end of each month in cents, delta-encoded against the previous month and written as a zigzag varint, so a
+ * steadily paid debt costs two or three bytes per month. Paid-off debts read as zero. Workers fill their own
+ * Buffer and flush it as a chunk once it exceeds BUFFER_BYTES, reserving the chunk's range of the file with one
+ * atomic add, so memory stays bounded and workers never wait on each other. The file can be mapped and walked
+ * chunk by chunk; the profile table at the end lists each profile's name and debt ids, one tab-separated line each.
+ */
+class TrajectoryRecorder {
+ public:
+    static constexpr size_t BUFFER_BYTES = 1 << 20;  ///< Size at which a worker's buffer is flushed as a chunk.
+
+    /**
+     * @class Buffer
+     * @brief Trajectories recorded by one worker since its last flush.
+     */
+    class Buffer {
+     private:
+        std::vector<TrajectoryEntry> entries;  ///< Recorded trajectories.
+        std::vector<uint8_t> values;           ///< Their encoded balances.
+        std::vector<double> balances;          ///< Balances of the trajectory being recorded, month-major.
+        size_t debts = 0;                      ///< Debts of the trajectory being recorded.
+
+        friend class TrajectoryRecorder;
+
+     public:
+        /**
+         * @brief Starts recording a trajectory.
+         * @param debts Number of debts of its portfolio.
+         */
+        void begin(size_t debts) {
+            this->debts = debts;
+            this->balances.clear();
+        }
+        /**
+         * @brief Records the balances at the end of a month.
+         * @param portfolio Portfolio of the trajectory.
+         */
+        void month(const Portfolio& portfolio) {
+            for (size_t i = 0; i < this->debts; i++) {
+                this->balances.push_back(portfolio.getBalance(i));
+            }
+        }
+        /**
+         * @brief Encodes the trajectory being recorded.
+         * @param entry Description of the trajectory; its months, debts and offset are filled in.
+         */
+        void end(TrajectoryEntry entry);
+
+        [[nodiscard]] auto size() const -> size_t {
+            return (this->entries.size() * sizeof(TrajectoryEntry)) + this->values.size();
+        }
+    };
+
+ private:
+    int fd;                                 ///< File descriptor of the output file.
+    uint64_t every;                         ///< Sampling interval.
+    std::string table;                      ///< Profile table written by close().
+    std::atomic<uint64_t> end;              ///< End of the last reserved chunk.
+    std::atomic<uint64_t> chunks{0};        ///< Chunks written.
+    std::atomic<uint64_t> trajectories{0};  ///< Trajectories written.
+
+    /**
+     * @brief Constructs a TrajectoryRecorder around an open file.
+     * @param fd File descriptor of the output file.
+     * @param every Sampling interval.
+     * @param table Profile table.
+     */
+    TrajectoryRecorder(int fd, uint64_t every, std::string table);
+
+ public:
+    TrajectoryRecorder(const TrajectoryRecorder&) = delete;
+    auto operator=(const TrajectoryRecorder&) -> TrajectoryRecorder& = delete;
+    ~TrajectoryRecorder();
+
+    /**
+     * @brief Creates the output file.
+     * @param path Path of the output file.
+     * @param every Records iterations i of each block with i % every == 0.
+     * @param profiles Profiles of the run; the debts of each profile's first cell are recorded.
+     * @return The recorder, or nullptr if the file cannot be created.
+     */
+    static auto open(const std::string& path, uint64_t every, const std::vector<Profile>& profiles)
+        -> std::unique_ptr<TrajectoryRecorder>;
+
+    /**
+     * @brief Checks whether an iteration is sampled.
+     * @param iteration Iteration within its block.
+     * @return True if the iteration must be recorded.
+     */
+    [[nodiscard]] auto isSampled(uint64_t iteration) const -> bool { return (iteration % this->every) == 0; }
+
+    /**
+     * @brief Appends the buffer as one chunk and empties it. Safe to call concurrently from several workers.
+     * @param buffer Buffer to flush.
+     */
+    void flush(Buffer& buffer);
+    /**
+     * @brief Writes the profile table and the header; call once every buffer has been flushed.
+     * @return True on success.
+     */
+    auto close() -> bool;
+
+    /**
+     * @brief Converts a trajectory file to a long CSV ("profile,block,iteration,month,debt,balance" per line).
+     * @param path Path of the trajectory file.
+     * @param csvPath Path of the CSV file to write.
+     * @return True on success.
+     */
+    static auto exportCsv(const std::string& path, const std::string& csvPath) -> bool;
+};
@@ -0,0 +1,15 @@
+/**
+ * @file TrajectoryResult.hpp
+ * @brief Defines the outcome of one simulated trajectory.
+ */
+#pragma once
+
+/**
+ * @struct TrajectoryResult
+ * @brief Outcome of one simulated trajectory.
+ */
+struct TrajectoryResult {
+    double totalPaid;     ///< Total paid toward the debts that were paid off.
+    int periods;          ///< Number of periods until the trajectory finished.
+    bool capped = false;  ///< Stopped at Scenario::maxPeriods with debt left.
+};
@@ -2,91 +2,150 @@
  * @file Worker.hpp
  * @brief Defines a Worker class to simulate financial operations and debt payment strategies.
  */
+#pragma once
 
 #include <cmath>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
-#include <mutex>
-#include <random>
-#include <thread>
+#include <utility>
 #include <vector>
 
+#include "BatchEngine.hpp"
 #include "Debt.hpp"
+#include "IncomeModel.hpp"
+#include "Portfolio.hpp"
+#include "Profile.hpp"
+#include "ResultSink.hpp"
+#include "Sampler.hpp"
+#include "Scheduler.hpp"
+#include "Statistics.hpp"
+#include "Sweep.hpp"
+#include "TrajectoryRecorder.hpp"
+
+/**
+ * @struct Job
+ * @brief Everything the workers of one simulation share; owned by the caller of simulate().
+ */
+struct Job {
+    const std::vector<Profile>* profiles = nullptr;              ///< Profiles to simulate.
+    Scheduler* scheduler = nullptr;                              ///< Source of the chunks of the current round.
+    std::vector<ChunkStats>* chunkStats = nullptr;               ///< Moments of each chunk of the round, one slot per cell.
+    std::vector<size_t>* chunkSlots = nullptr;                   ///< First slot of each chunk in chunkStats.
+    ResultSink* sink = nullptr;                                  ///< Optional destination of the raw results.
+    TrajectoryRecorder* recorder = nullptr;                      ///< Optional destination of sampled trajectories.
+    uint64_t seed = 0;                                           ///< Seed every random stream is derived from.
+    bool simd = true;                                            ///< Uses the lane-parallel BatchEngine.
+    bool events = false;                                         ///< Uses the event-driven scalar engine.
+    Sampler::MODE_E sampling = Sampler::MODE_PLAIN;              ///< Sampling scheme of the payment draws.
+    int samplingMonths = 0;                                      ///< Months covered by halton or stratified sampling.
+};
 
 /**
  * @class Worker
- * @brief Represents a worker thread simulating debt payment and financial decisions.
+ * @brief Simulation state of one pool thread: its statistics and its random draws.
+ *
+ * Workers take chunks of iterations from the Scheduler and simulate every cell of the chunk's profile on each one,
+ * so all cells see the same random payments and the profile's parsed portfolios stay hot in cache. The moments of
+ * each chunk go to the job's chunkStats, so the merged results do not depend on which worker ran the chunk. The
+ * scratch portfolios and result buffers are built on first use and only reset afterwards, so once every profile has
+ * been seen a worker simulates without touching the heap.
  */
 class Worker {
  private:
-    int iter;                                             ///< Number of iterations the worker will perform.
-    int id;                                               ///< Unique ID of the worker thread.
-    std::thread t;                                        ///< Thread object associated with the worker.
-    static std::mt19937 gen;                              ///< Random number generator for payment amounts.
-    static std::mutex rngMutex;                           ///< Mutex for thread-safe RNG access.
-    static std::uniform_real_distribution<double> distr;  ///< Distribution for random payments.
-    static std::vector<Debt> masterDebt;                  ///< Shared debt configuration across all workers.
+    unsigned int id;                                      ///< Unique ID of the worker, selecting its scheduler deque.
+    const Job* job;                                       ///< Simulation the worker belongs to.
+    Sampler sampler;                                      ///< Payment draws of the current block, keyed by (seed, block, iteration).
+    const IncomeModel* income = nullptr;                  ///< Payment ranges of the current cell.
+    int maxPeriods = 0;                                   ///< Period cap of the current cell.
+    IncomeModel::Payments payments{};                     ///< Payments of the current block of months.
+    int shock = 0;                                        ///< Remaining months of the current income shock.
+    std::vector<std::vector<ResultStats>> stats;          ///< Histograms and sketches of this worker's results, per profile and cell.
+    std::vector<std::vector<Portfolio>> debts;            ///< Scratch portfolios of the scalar engines, per profile and cell.
+    std::vector<std::vector<TrajectoryResult>> results;   ///< Results of the current chunk, per cell.
+    TrajectoryRecorder::Buffer recorded;                  ///< Sampled trajectories not yet flushed to the job's recorder.
 
  public:
     /**
      * @brief Constructs a Worker object.
-     * @param iter Number of iterations to perform.
-     * @param id Unique ID for the worker.
+     * @param id Unique ID for the worker, selecting its scheduler deque.
+     * @param job Simulation the worker belongs to; must outlive the worker.
      */
-    Worker(int iter, int id) : iter(iter), id(id) {}
+    Worker(unsigned int id, const Job& job);
 
     /**
-     * @brief Main simulation function for the worker.
+     * @brief Simulates chunks of the job's current round until its scheduler runs dry.
      */
     void run();
     /**
-     * @brief Starts the worker thread.
-     */
-    void start();
-    /**
-     * @brief Joins the worker thread to the main thread.
+     * @brief Simulates iterations [begin, end) of a block under one cell.
+     * @param cell Cell to simulate.
+     * @param debts Scratch copy of the cell's portfolio for the scalar engine.
+     * @param block Block, selecting the random stream.
+     * @param begin First iteration.
+     * @param end One past the last iteration.
+     * @param out Destination; the result of iteration i is written to out[i - begin].
      */
-    void join();
+    void simulateChunk(const Cell& cell, Portfolio& debts, uint64_t block, int begin, int end, TrajectoryResult* out);
     /**
-     * @brief Sets the shared debt configuration for all workers.
-     * @param d Reference to the debt vector.
+     * @brief simulateChunk instantiated for the cell's policy.
+     * @tparam P Policy of the month loop.
      */
-    static void setMasterDebt(std::vector<Debt>& d);
-
+    template <PaymentPolicy P>
+    void simulateChunkWith(const Cell& cell, Portfolio& debts, uint64_t block, int begin, int end,
+                           TrajectoryResult* out);
     /**
-     * @brief Calculates a random payment amount based on the period.
-     * @param period The current simulation period.
-     * @return Random payment amount.
+     * @brief Records the sampled iterations of [begin, end) of a block to the job's recorder.
+     *
+     * The trajectories are simulated again with the scalar engine, which every other engine matches bit for bit,
+     * so the engine of the chunk never has to look at balances.
+     * @param cell Cell to record.
+     * @param debts Scratch copy of the cell's portfolio.
+     * @param group Profile of the cell.
+     * @param block Block, selecting the random stream.
+     * @param begin First iteration.
+     * @param end One past the last iteration.
      */
-    static auto getRandom(int period) -> double;
+    void record(const Cell& cell, Portfolio& debts, size_t group, uint64_t block, int begin, int end);
     /**
-     * @brief Calculates a range of payment amounts based on the simulation period.
-     * @param periods The current number of periods elapsed.
-     * @return A pair representing the minimum and maximum payment amounts.
+     * @struct NoObserver
+     * @brief Month observer of simulate() that does nothing.
      */
-    static auto getPayRange(int periods) -> std::pair<double, double>;
+    struct NoObserver {
+        void operator()([[maybe_unused]] const Portfolio& debts) const {}
+    };
     /**
-     * @brief Pays off forced debts using available payment.
-     * @param debts Reference to the vector of debts.
-     * @param payment Reference to the payment amount.
+     * @brief Simulates one trajectory with the scalar engine.
+     * @param debts Portfolio to simulate; reset by this function.
+     * @param i Iteration index, selecting the random stream.
+     * @param observe Called with the portfolio at the end of every month.
+     * @return Outcome of the trajectory.
+     * @tparam P Policy of the month loop.
      */
-    static void payForcedDebt(std::vector<Debt>& debts, double& payment);
+    template <PaymentPolicy P, class Observer = NoObserver>
+    auto simulate(Portfolio& debts, int i, Observer observe = {}) -> TrajectoryResult;
     /**
-     * @brief Pays off non-forced debts using available payment.
-     * @param debts Reference to the vector of debts.
-     * @param payment Reference to the payment amount.
+     * @brief Simulates one trajectory with the event-driven scalar engine, bit-identical to simulate().
+     *
+     * Between two events (a debt taken, a compounding boundary, a debt paid off) a period only pays the forced debts
+     * and the first taken debt in payment order, so those periods skip the passes over the whole portfolio.
+     * @param debts Portfolio to simulate; reset by this function.
+     * @param i Iteration index, selecting the random stream.
+     * @return Outcome of the trajectory.
+     * @tparam P Policy of the month loop.
      */
-    static void payNonForcedDebt(std::vector<Debt>& debts, double& payment);
+    template <PaymentPolicy P>
+    auto simulateEvents(Portfolio& debts, int i) -> TrajectoryResult;
     /**
-     * @brief Calculates the total debt from a vector of debts.
-     * @param debts Reference to the vector of debts.
-     * @return Total debt amount.
+     * @brief Gets the histograms and sketches of this worker's results; valid once the round has finished.
+     * @return Summary of the worker's results without moments (see ChunkStats), per profile and cell.
      */
-    static auto getTotalDebt(std::vector<Debt>& debts) -> double;
+    [[nodiscard]] auto getStats() const -> const std::vector<std::vector<ResultStats>>& { return this->stats; }
+
     /**
-     * @brief Calculates the total paid amount from a vector of debts.
-     * @param debts Reference to the vector of debts.
-     * @return Total paid amount.
+     * @brief Gets the random payment of a period, drawing the next block of months when it starts one.
+     * @param period The current simulation period; periods are visited in order from 0.
+     * @return Random payment amount.
      */
-    static auto getTotalPaid(std::vector<Debt>& debts) -> double;
+    auto getRandom(int period) -> double;
 };
@@ -1,19 +1,12 @@
 /**
  * @file flags.hpp
- * @brief Defines global flags and configurations for the application.
+ * @brief Defines compile-time build flags. Scenario and output options are runtime settings, see Config.
  */
+#pragma once
 
 #define DEBUG false               ///< Enables debug print statements.
-#define KID true                  ///< Specifies if the simulation involves having a child.
-#define ITERATIONS (1024 * 1024)  ///< Number of iterations for each core.
-#define AGGRESSIVE true           ///< Determines whether put paid off required debts into paying of other debts faster.
-
-// Determines the aggressive payment offset based on the AGGRESSIVE flag.
-#if AGGRESSIVE
-#define AGGRESSIVE_OFFSET (475.0)  ///< Sum of monthly required payments for aggressive mode.
-#else
-#define AGGRESSIVE_OFFSET (0.0)  ///< Offset for non-aggressive mode.
-#endif
+#define INSTRUMENT false          ///< Enables the per-phase counters and timers of Instrumentation.hpp.
+#define BATCH_CHUNK 4096          ///< Number of iterations a worker simulates before handing them to the sink.
 
 /**
  * @macro DEBUG_PRINT
@@ -21,5 +14,3 @@
  */
 #define DEBUG_PRINT(...) \
     if (DEBUG) std::println(__VA_ARGS__)
-
-#define FILE_PREFIX "sim_"  ///< Prefix for output simulation files.
@@ -0,0 +1,67 @@
+/**
+ * @file Adaptive.cpp
+ * @brief Implements the stopping rule of adaptive runs.
+ */
+
+#include "Adaptive.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * @brief Constructs an Adaptive stopping rule.
+ * @param target Largest accepted relative half-width of the confidence intervals; 0 disables early exit.
+ * @param confidence Confidence level of the intervals, in (0, 1).
+ * @param cap Hard limit on the number of iterations.
+ * @param minimum Size of the first round.
+ */
+Adaptive::Adaptive(double target, double confidence, uint64_t cap, uint64_t minimum)
+    : target(target), z(0.0), cap(cap), minimum(minimum) {
+    // Solve erfc(z / sqrt(2)) = 1 - confidence by bisection; erfc is decreasing
+    double lo = 0.0;
+    double hi = 40.0;
+    for (int i = 0; i < 100; i++) {
+        double mid = 0.5 * (lo + hi);
+        if (std::erfc(mid / std::sqrt(2.0)) > (1.0 - confidence)) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    this->z = 0.5 * (lo + hi);
+}
+
+/**
+ * @brief Gets the number of iterations of the first round.
+ * @return Iterations to simulate first.
+ */
+auto Adaptive::firstRound() const -> uint64_t { return isEnabled() ? std::min(this->cap, this->minimum) : this->cap; }
+
+/**
+ * @brief Gets the relative half-width of the confidence interval of a mean.
+ * @param s Accumulator.
+ * @return Half-width divided by the magnitude of the mean (0 for a constant sample).
+ */
+auto Adaptive::halfWidth(const RunningStats& s) const -> double {
+    if (s.stddev() == 0.0) {
+        return 0.0;
+    }
+    return this->z * s.stddev() / (std::sqrt(static_cast<double>(s.count())) * std::abs(s.mean()));
+}
+
+/**
+ * @brief Decides the total number of iterations after a round.
+ * @param done Iterations simulated so far.
+ * @param widest Largest relative half-width over every estimate.
+ * @return New total, or done to stop.
+ */
+auto Adaptive::nextRound(uint64_t done, double widest) const -> uint64_t {
+    if (!isEnabled() || (widest <= this->target) || (done >= this->cap)) {
+        return done;
+    }
+    // The half-width shrinks with 1 / sqrt(n): aim 10% past the projected count, growing at least by half and at
+    // most fourfold per round so a noisy early estimate cannot overshoot by much
+    double projected = 1.1 * static_cast<double>(done) * (widest / this->target) * (widest / this->target);
+    double next = std::clamp(projected, 1.5 * static_cast<double>(done), 4.0 * static_cast<double>(done));
+    return std::min(this->cap, static_cast<uint64_t>(next));
+}
@@ -0,0 +1,388 @@
+/**
+ * @file BatchEngine.cpp
+ * @brief Implements the lane-parallel trajectory engine and its runtime CPU dispatch.
+ */
+
+#include "BatchEngine.hpp"
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <span>
+#include <utility>
+
+#include "Sampler.hpp"
+
+// Every helper taking or returning a vector type is always inlined into a kernel compiled for the matching ISA,
+// so no vector ever crosses an ABI boundary.
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+namespace {
+
+/**
+ * @struct Lanes
+ * @brief GCC vector types holding one value per trajectory.
+ */
+template <int W>
+struct Lanes {
+    typedef double D __attribute__((vector_size(W * sizeof(double))));     ///< One double per lane.
+    typedef int64_t I __attribute__((vector_size(W * sizeof(int64_t))));   ///< One mask / integer per lane.
+};
+
+/**
+ * @brief Masked vector version of Debt::pay.
+ * @param principal Principal of one debt in every lane.
+ * @param paid Amount paid toward that debt in every lane.
+ * @param payment Payment of every lane. Adjusted after the function.
+ * @param mask Lanes the payment applies to.
+ */
+template <int W>
+[[gnu::always_inline]] inline void payLanes(typename Lanes<W>::D& principal, typename Lanes<W>::D& paid,
+                                            typename Lanes<W>::D& payment, typename Lanes<W>::I mask) {
+    using D = typename Lanes<W>::D;
+    typename Lanes<W>::I over = payment > principal;
+    D amount = over ? principal : payment;
+    D remainingPrincipal = over ? D{} : principal - payment;
+    D remainingPayment = over ? payment - principal : D{};
+    paid = mask ? paid + amount : paid;
+    principal = mask ? remainingPrincipal : principal;
+    payment = mask ? remainingPayment : payment;
+}
+
+/**
+ * @brief Vector version of Debt::isBasicallyZero.
+ * @param d Values to check.
+ * @return Mask of the lanes that are close to zero.
+ */
+template <int W>
+[[gnu::always_inline]] inline auto isBasicallyZero(typename Lanes<W>::D d) -> typename Lanes<W>::I {
+    using D = typename Lanes<W>::D;
+    D magnitude = d < 0.0 ? -d : d;
+    return magnitude <= (D{} + Debt::EPSILON);
+}
+
+/**
+ * @brief Simulates iterations [begin, end) W trajectories at a time.
+ * @param pf Portfolio every trajectory starts from.
+ * @param income Payment ranges of the scenario.
+ * @param sampler Payment draws of the block, copied into every lane.
+ * @param maxPeriods Periods after which a trajectory with debt left is stopped.
+ * @param begin First iteration.
+ * @param end One past the last iteration.
+ * @param out Destination; the result of iteration i is written to out[i - begin].
+ * @tparam P Policy of the month loop.
+ */
+template <int W, PaymentPolicy P>
+[[gnu::always_inline]] inline void simulateLanes(const Portfolio& pf, const IncomeModel& income,
+                                                 const Sampler& sampler, int maxPeriods, int begin, int end,
+                                                 TrajectoryResult* out) {
+    using D = typename Lanes<W>::D;
+    using I = typename Lanes<W>::I;
+    const size_t n = pf.size();
+    std::span<const double> initialPrincipal = pf.getInitialPrincipal();
+    std::span<const double> growth = pf.getGrowth();
+    std::span<const double> minimumPayment = pf.getMinimumPayment();
+    std::span<const int> periodTaken = pf.getPeriodTaken();
+    std::span<const int> compoundInterval = pf.getCompoundInterval();
+    const uint64_t forcedMask = pf.getForcedMask();
+    const int kidIndex = pf.getKidIndex();
+
+    // Group debts by compounding interval so each month needs one modulo per distinct interval
+    std::array<int64_t, Portfolio::MAX_DEBTS> intervals{};
+    std::array<size_t, Portfolio::MAX_DEBTS> intervalOf{};
+    size_t numIntervals = 0;
+    for (size_t i = 0; i < n; i++) {
+        size_t k = 0;
+        while ((k < numIntervals) && (intervals[k] != compoundInterval[i])) {
+            k++;
+        }
+        if (k == numIntervals) {
+            intervals[numIntervals++] = compoundInterval[i];
+        }
+        intervalOf[i] = k;
+    }
+    // Fixed capacity keeps the over-aligned vector types on the (realigned) stack of the kernel, and every scratch
+    // array off the heap, so a chunk allocates nothing
+    std::array<I, Portfolio::MAX_DEBTS> boundary{};
+    std::array<D, Portfolio::MAX_DEBTS> principal{};
+    std::array<D, Portfolio::MAX_DEBTS> paid{};
+    auto samplers = [&]<size_t... J>(std::index_sequence<J...>) {
+        return std::array<Sampler, W>{((void)J, sampler)...};
+    }(std::make_index_sequence<W>{});
+    std::array<IncomeModel::Payments, W> payments{};
+    std::array<int, W> shock{};
+    std::array<int, W> iteration{};
+    I active{};
+    I live{};
+    I periods{};
+    D totalPaid{};
+    int next = begin;
+
+    // Debts that start at zero are retired in their first month without being paid
+    uint64_t initiallyZero = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (Debt::isBasicallyZero(initialPrincipal[i])) {
+            initiallyZero |= (1ULL << i);
+        }
+    }
+
+    // Lanes are refilled together once every lane of the batch has retired. Refilling a lane as soon as it
+    // finishes puts trajectories that are months apart into one vector, and the passes below then have to visit
+    // nearly every debt of the portfolio each month.
+    auto refill = [&]() {
+        for (int j = 0; (j < W) && (next < end); j++) {
+            iteration[j] = next;
+            samplers[j].seek(static_cast<uint64_t>(next));
+            shock[j] = 0;
+            next++;
+            for (size_t i = 0; i < n; i++) {
+                principal[i][j] = initialPrincipal[i];
+                paid[i][j] = 0.0;
+            }
+            active[j] = static_cast<int64_t>(pf.getInitialMask());
+            live[j] = -1;
+            periods[j] = 0;
+            totalPaid[j] = 0.0;
+        }
+    };
+    auto any = [](I mask) {
+        int64_t res = 0;
+        for (int j = 0; j < W; j++) {
+            res |= mask[j];
+        }
+        return res;
+    };
+    refill();
+
+    while (any(live) != 0) {
+        // Passes below only visit debts that are still active in at least one lane
+        auto anyActive = static_cast<uint64_t>(any(active));
+        periods += 1;
+
+        // Accrue, skipped entirely in months where no lane crosses a compounding boundary
+        int64_t anyBoundary = 0;
+        for (size_t k = 0; k < numIntervals; k++) {
+            boundary[k] = ((periods % intervals[k]) == 0) & live;
+            anyBoundary |= any(boundary[k]);
+        }
+        if (anyBoundary != 0) {
+            for (uint64_t m = anyActive; m != 0; m &= m - 1) {
+                auto i = static_cast<size_t>(std::countr_zero(m));
+                I present = ((active >> static_cast<int64_t>(i)) & 1) != 0;
+                I taken = (I{} + periodTaken[i]) <= periods;
+                I due = present & taken & boundary[intervalOf[i]];
+                principal[i] = due ? principal[i] * growth[i] : principal[i];
+            }
+        }
+
+        D payment{};
+        for (int j = 0; j < W; j++) {
+            if (live[j] != 0) {
+                auto month = static_cast<int>(periods[j] - 1);
+                if ((month % IncomeModel::BLOCK) == 0) {
+                    income.draw(samplers[j], month, shock[j], payments[j]);
+                }
+                payment[j] = payments[j][month % IncomeModel::BLOCK];
+            }
+        }
+
+        // Forced payments
+        uint64_t touched = (forcedMask | initiallyZero) & anyActive;
+        for (uint64_t m = forcedMask & anyActive; m != 0; m &= m - 1) {
+            auto i = static_cast<size_t>(std::countr_zero(m));
+            I present = ((active >> static_cast<int64_t>(i)) & 1) != 0;
+            I taken = (I{} + periodTaken[i]) <= periods;
+            D forced = D{} + minimumPayment[i];
+            payLanes<W>(principal[i], paid[i], forced, present & taken);
+            if constexpr (P::aggressive) {
+                payment = (present & taken) ? payment - (minimumPayment[i] - forced) : payment;
+            }
+        }
+
+        I cascading = live;
+        if constexpr (P::proportional) {
+            // Lanes whose payment is below their total balance split it without paying anything off
+            D total{};
+            for (uint64_t m = anyActive & ~forcedMask; m != 0; m &= m - 1) {
+                auto i = static_cast<size_t>(std::countr_zero(m));
+                I present = ((active >> static_cast<int64_t>(i)) & 1) != 0;
+                I taken = (I{} + periodTaken[i]) <= periods;
+                total = (present & taken) ? total + principal[i] : total;
+            }
+            I split = live & (payment < total);
+            if (any(split) != 0) {
+                D share = split ? payment / total : D{};
+                for (uint64_t m = anyActive & ~forcedMask; m != 0; m &= m - 1) {
+                    auto i = static_cast<size_t>(std::countr_zero(m));
+                    I present = ((active >> static_cast<int64_t>(i)) & 1) != 0;
+                    I taken = (I{} + periodTaken[i]) <= periods;
+                    D part = principal[i] * share;
+                    payLanes<W>(principal[i], paid[i], part, split & present & taken);
+                    touched |= (1ULL << i);
+                }
+                payment = split ? D{} : payment;
+                cascading &= ~split;
+            }
+        }
+
+        // Cascade: non-forced debts in payment order; lanes stop once their payment is spent
+        for (uint64_t m = anyActive & ~forcedMask; (m != 0) && (any(cascading) != 0); m &= m - 1) {
+            auto i = static_cast<size_t>(std::countr_zero(m));
+            I present = ((active >> static_cast<int64_t>(i)) & 1) != 0;
+            I taken = (I{} + periodTaken[i]) <= periods;
+            payLanes<W>(principal[i], paid[i], payment, cascading & present & taken);
+            cascading &= ~(present & isBasicallyZero<W>(payment));
+            touched |= (1ULL << i);
+        }
+        // If all non-forced debts are zero, pay off forced debts early
+        if (any(cascading) != 0) {
+            for (uint64_t m = anyActive; m != 0; m &= m - 1) {
+                auto i = static_cast<size_t>(std::countr_zero(m));
+                I present = ((active >> static_cast<int64_t>(i)) & 1) != 0;
+                I taken = (I{} + periodTaken[i]) <= periods;
+                payLanes<W>(principal[i], paid[i], payment, cascading & present & taken);
+                touched |= (1ULL << i);
+            }
+        }
+
+        // Retire paid-off debts; only debts paid this month can have reached zero
+        I retired{};
+        for (uint64_t m = touched; m != 0; m &= m - 1) {
+            auto i = static_cast<size_t>(std::countr_zero(m));
+            I present = ((active >> static_cast<int64_t>(i)) & 1) != 0;
+            I zero = present & isBasicallyZero<W>(principal[i]);
+            totalPaid = zero ? totalPaid + paid[i] : totalPaid;
+            retired |= zero & static_cast<int64_t>(1ULL << i);
+        }
+        active &= ~retired;
+
+        I done = ~isBasicallyZero<W>(payment);
+        if (P::kid && (kidIndex >= 0)) {
+            done |= active == static_cast<int64_t>(1ULL << kidIndex);
+        }
+        done &= live;
+        I capped = live & ~done & (periods >= maxPeriods);
+        done |= capped;
+        for (int j = 0; j < W; j++) {
+            if (done[j] != 0) {
+                out[iteration[j] - begin] = {totalPaid[j], static_cast<int>(periods[j]), capped[j] != 0};
+                active[j] = 0;
+                live[j] = 0;
+            }
+        }
+        if (any(live) == 0) {
+            refill();
+        }
+    }
+}
+
+/**
+ * @brief Signature shared by every kernel.
+ */
+using Kernel = void (*)(const Portfolio&, const IncomeModel&, const Sampler&, int, int, int, TrajectoryResult*);
+
+// 256-bit lanes with AVX-512VL mask registers; 8-lane batches lose more to divergence between trajectories than
+// the wider vectors gain.
+template <PaymentPolicy P>
+[[gnu::target("avx512f,avx512vl,avx512dq"), gnu::flatten]] void simulateAvx512(const Portfolio& pf,
+                                                                               const IncomeModel& income,
+                                                                               const Sampler& sampler,
+                                                                               int maxPeriods, int begin, int end,
+                                                                               TrajectoryResult* out) {
+    simulateLanes<4, P>(pf, income, sampler, maxPeriods, begin, end, out);
+}
+
+template <PaymentPolicy P>
+[[gnu::target("avx2"), gnu::flatten]] void simulateAvx2(const Portfolio& pf, const IncomeModel& income,
+                                                        const Sampler& sampler, int maxPeriods, int begin, int end,
+                                                        TrajectoryResult* out) {
+    simulateLanes<4, P>(pf, income, sampler, maxPeriods, begin, end, out);
+}
+
+template <PaymentPolicy P>
+[[gnu::flatten]] void simulateScalar(const Portfolio& pf, const IncomeModel& income, const Sampler& sampler,
+                                     int maxPeriods, int begin, int end, TrajectoryResult* out) {
+    simulateLanes<1, P>(pf, income, sampler, maxPeriods, begin, end, out);
+}
+
+/**
+ * @brief Picks the kernel instantiated for a policy.
+ * @param isa Instruction set.
+ * @return Kernel to call.
+ * @tparam P Policy of the month loop.
+ */
+template <PaymentPolicy P>
+auto pickKernel(BatchEngine::ISA_E isa) -> Kernel {
+    switch (isa) {
+        case BatchEngine::ISA_AVX512:
+            return simulateAvx512<P>;
+        case BatchEngine::ISA_AVX2:
+            return simulateAvx2<P>;
+        default:
+            return simulateScalar<P>;
+    }
+}
+
+}  // namespace
+
+/**
+ * @brief Simulates iterations [begin, end).
+ * @param begin First iteration.
+ * @param end One past the last iteration.
+ * @param out Destination; the result of iteration i is written to out[i - begin].
+ */
+void BatchEngine::run(int begin, int end, TrajectoryResult* out) const {
+    // The scenario switches are template parameters of the kernels, so they cost nothing inside the month loop
+    Kernel kernel = nullptr;
+    withPolicy(this->aggressive, this->kid, this->proportional,
+               [&]<PaymentPolicy P>() { kernel = pickKernel<P>(this->isa); });
+    kernel(this->portfolio, this->income, this->sampler, this->maxPeriods, begin, end, out);
+}
+
+/**
+ * @brief Detects the widest kernel supported by the CPU.
+ * @return Kernel to use.
+ */
+auto BatchEngine::detectIsa() -> ISA_E {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx512dq")) {
+        return ISA_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return ISA_AVX2;
+    }
+    return ISA_SCALAR;
+}
+
+/**
+ * @brief Gets the number of trajectories advanced together by a kernel.
+ * @param isa Kernel.
+ * @return Number of lanes.
+ */
+auto BatchEngine::laneWidth(ISA_E isa) -> int {
+    switch (isa) {
+        case ISA_AVX512:
+        case ISA_AVX2:
+            return 4;
+        default:
+            return 1;
+    }
+}
+
+/**
+ * @brief Converts a kernel to a string.
+ * @param isa Kernel.
+ * @return String representation of the kernel.
+ */
+auto BatchEngine::printIsa(ISA_E isa) -> std::string {
+    switch (isa) {
+        case ISA_AVX512:
+            return "avx512";
+        case ISA_AVX2:
+            return "avx2";
+        case ISA_SCALAR:
+            return "scalar";
+        default:
+            return "invalid";
+    }
+}
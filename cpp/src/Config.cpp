@@ -0,0 +1,371 @@
+/**
+ * @file Config.cpp
+ * @brief Implements the runtime configuration parser.
+ */
+
+#include "Config.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <print>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Options taking a boolean, which mean true when given on the command line without a value.
+ */
+constexpr std::string_view BOOL_KEYS[] = {"kid", "aggressive", "simd", "events", "write-results", "json"};
+
+/**
+ * @brief Trims surrounding whitespace.
+ * @param s Text to trim.
+ * @return Trimmed view of s.
+ */
+auto trim(std::string_view s) -> std::string_view {
+    size_t first = s.find_first_not_of(" \t\r");
+    if (first == std::string_view::npos) {
+        return {};
+    }
+    size_t last = s.find_last_not_of(" \t\r");
+    return s.substr(first, last - first + 1);
+}
+
+/**
+ * @brief Parses a number, rejecting trailing garbage.
+ * @param s Text to parse.
+ * @param out Destination.
+ * @return True on success.
+ */
+template <typename T>
+auto parseNumber(std::string_view s, T& out) -> bool {
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), out);
+    return (ec == std::errc()) && (ptr == s.data() + s.size());
+}
+
+/**
+ * @brief Parses a boolean (true/false, 1/0, yes/no, on/off).
+ * @param s Text to parse.
+ * @param out Destination.
+ * @return True on success.
+ */
+auto parseBool(std::string_view s, bool& out) -> bool {
+    if ((s == "true") || (s == "1") || (s == "yes") || (s == "on")) {
+        out = true;
+        return true;
+    }
+    if ((s == "false") || (s == "0") || (s == "no") || (s == "off")) {
+        out = false;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Parses a list of one-off raises ("MONTH:MULTIPLIER,..."); "none" is the empty list.
+ * @param s Text to parse.
+ * @param out Destination.
+ * @return True on success.
+ */
+auto parseRaises(std::string_view s, std::vector<std::pair<int, double>>& out) -> bool {
+    out.clear();
+    if (s == "none") {
+        return true;
+    }
+    while (!s.empty()) {
+        size_t comma = s.find(',');
+        std::string_view item = s.substr(0, comma);
+        size_t colon = item.find(':');
+        std::pair<int, double> raise;
+        if ((colon == std::string_view::npos) || !parseNumber(item.substr(0, colon), raise.first) ||
+            !parseNumber(item.substr(colon + 1), raise.second) || (raise.first < 0) || (raise.second < 0.0)) {
+            return false;
+        }
+        out.push_back(raise);
+        s = (comma == std::string_view::npos) ? std::string_view{} : s.substr(comma + 1);
+    }
+    return !out.empty();
+}
+
+/**
+ * @brief Parses a shard as "K/N".
+ * @param s Text to parse.
+ * @param shard Shard index, in [0, shards).
+ * @param shards Number of shards.
+ * @return True on success.
+ */
+auto parseShard(std::string_view s, unsigned int& shard, unsigned int& shards) -> bool {
+    size_t slash = s.find('/');
+    return (slash != std::string_view::npos) && parseNumber(s.substr(0, slash), shard) &&
+           parseNumber(s.substr(slash + 1), shards) && (shard < shards);
+}
+
+}  // namespace
+
+/**
+ * @brief Applies one option.
+ * @param key Option name without leading dashes.
+ * @param value Option value.
+ * @return True if the option is known and its value valid.
+ */
+auto Config::set(std::string_view key, std::string_view value) -> bool {
+    Scenario& s = this->scenario;
+    bool ok = false;
+    if (key == "config") {
+        ok = load(std::string(value));
+    } else if (key == "debts") {
+        this->debtFile = value;
+        ok = !value.empty();
+    } else if (key == "portfolios") {
+        this->portfolios = value;
+        ok = !value.empty();
+    } else if (key == "kid") {
+        ok = parseBool(value, s.kid);
+    } else if (key == "aggressive") {
+        ok = parseBool(value, s.aggressive);
+    } else if (key == "aggressive-offset") {
+        ok = parseNumber(value, s.aggressiveOffset) && (s.aggressiveOffset >= 0.0);
+    } else if (key == "iterations") {
+        ok = parseNumber(value, s.iterations) && (s.iterations > 0);
+    } else if (key == "payment-min") {
+        // The order of the two ends is checked once every option is set, see Scenario::validate
+        ok = parseNumber(value, s.paymentMin) && (s.paymentMin >= 0.0);
+    } else if (key == "payment-max") {
+        ok = parseNumber(value, s.paymentMax) && (s.paymentMax >= 0.0);
+    } else if (key == "payment-extra") {
+        ok = parseNumber(value, s.paymentExtra);
+    } else if (key == "payment-growth-rate") {
+        ok = parseNumber(value, s.paymentGrowthRate) && (s.paymentGrowthRate >= 0.0);
+    } else if (key == "payment-growth-frequency") {
+        ok = parseNumber(value, s.paymentGrowthFrequency) && (s.paymentGrowthFrequency > 0);
+    } else if (key == "raises") {
+        ok = parseRaises(value, s.raises);
+    } else if (key == "shock-probability") {
+        ok = parseNumber(value, s.shockProbability) && (s.shockProbability >= 0.0) && (s.shockProbability <= 1.0);
+    } else if (key == "shock-factor") {
+        // A shock that takes the whole payment could last forever at probability 1
+        ok = parseNumber(value, s.shockFactor) && (s.shockFactor > 0.0);
+    } else if (key == "max-periods") {
+        // Periods are stored as uint16 in results files
+        ok = parseNumber(value, s.maxPeriods) && (s.maxPeriods > 0) && (s.maxPeriods <= UINT16_MAX);
+    } else if (key == "shock-months") {
+        ok = parseNumber(value, s.shockMonths) && (s.shockMonths > 0);
+    } else if (key == "strategy") {
+        auto strategy = Strategy::fromString(value);
+        ok = strategy.has_value();
+        s.strategy = strategy.value_or(s.strategy);
+    } else if (key == "hybrid-threshold") {
+        ok = parseNumber(value, s.hybridThreshold);
+    } else if (key == "target-ci") {
+        ok = parseNumber(value, this->targetCi) && (this->targetCi >= 0.0);
+    } else if (key == "confidence") {
+        ok = parseNumber(value, this->confidence) && (this->confidence > 0.0) && (this->confidence < 1.0);
+    } else if (key == "min-iterations") {
+        ok = parseNumber(value, this->minIterations) && (this->minIterations > 0);
+    } else if (key == "sampling") {
+        auto mode = Sampler::fromString(value);
+        ok = mode.has_value();
+        this->sampling = mode.value_or(this->sampling);
+    } else if (key == "sampling-months") {
+        ok = parseNumber(value, this->samplingMonths) && (this->samplingMonths >= 0) &&
+             (this->samplingMonths <= Sampler::MAX_MONTHS);
+    } else if (key == "replicates") {
+        ok = parseNumber(value, this->replicates) && (this->replicates >= 2);
+    } else if (key == "seed") {
+        uint64_t seed = 0;
+        ok = parseNumber(value, seed);
+        this->seed = seed;
+    } else if (key == "shard") {
+        ok = parseShard(value, this->shard, this->shards);
+    } else if (key == "threads") {
+        ok = parseNumber(value, this->threads);
+    } else if (key == "simd") {
+        ok = parseBool(value, this->simd);
+    } else if (key == "events") {
+        ok = parseBool(value, this->events);
+    } else if (key == "write-results") {
+        ok = parseBool(value, this->writeResults);
+    } else if (key == "result-format") {
+        ok = (value == "binary") || (value == "csv");
+        this->resultBinary = (value == "binary");
+    } else if (key == "record-every") {
+        ok = parseNumber(value, this->recordEvery);
+    } else if (key == "json") {
+        ok = parseBool(value, this->json);
+    } else if (key == "sweep") {
+        this->sweep.emplace_back(value);
+        ok = value.find('=') != std::string_view::npos;
+    } else {
+        std::cerr << "Error: Unknown option: " << key << '\n';
+        return false;
+    }
+    if (!ok) {
+        std::cerr << "Error: Invalid value for " << key << ": " << value << '\n';
+        return false;
+    }
+    // Shards of one run must agree on these, but not on how each process runs or prints (config expands in place)
+    if ((key != "config") && (key != "shard") && (key != "threads") && (key != "simd") && (key != "events") &&
+        (key != "record-every") && (key != "json")) {
+        this->options += std::format("{}={}\n", key, value);
+    }
+    return true;
+}
+
+/**
+ * @brief Applies every `key=value` line of a config file.
+ * @param path Path of the config file.
+ * @return True if the file could be read and every option is valid.
+ */
+auto Config::load(const std::string& path) -> bool {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open file: " << path << '\n';
+        return false;
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+    return apply(text.str(), path);
+}
+
+/**
+ * @brief Applies every `key=value` line of a text, such as the options recorded by another run.
+ * @param text Lines to apply.
+ * @param source Name of the text in error messages.
+ * @return True if every option is valid.
+ */
+auto Config::apply(std::string_view text, std::string_view source) -> bool {
+    while (!text.empty()) {
+        std::string_view line = text.substr(0, text.find('\n'));
+        text.remove_prefix(std::min(text.size(), line.size() + 1));
+        std::string_view l = trim(line.substr(0, line.find('#')));
+        if (l.empty()) {
+            continue;
+        }
+        size_t eq = l.find('=');
+        if (eq == std::string_view::npos) {
+            std::cerr << "Error: Expected key=value in " << source << ": " << l << '\n';
+            return false;
+        }
+        if (!set(trim(l.substr(0, eq)), trim(l.substr(eq + 1)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Builds a configuration from the command line.
+ * @param argc Argument count.
+ * @param argv Argument values.
+ * @return The configuration, or std::nullopt on invalid input or --help.
+ */
+auto Config::parse(int argc, char** argv) -> std::optional<Config> {
+    Config config;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if ((arg == "--help") || (arg == "-h")) {
+            printUsage();
+            return std::nullopt;
+        }
+        if (!arg.starts_with("--")) {
+            std::cerr << "Error: Unexpected argument: " << arg << '\n';
+            return std::nullopt;
+        }
+        arg.remove_prefix(2);
+        std::string_view key = arg;
+        std::string_view value;
+        bool flag = false;
+        if (size_t eq = arg.find('='); eq != std::string_view::npos) {
+            key = arg.substr(0, eq);
+            value = arg.substr(eq + 1);
+        } else if (std::ranges::find(BOOL_KEYS, key) != std::end(BOOL_KEYS)) {
+            // A bare boolean option is true; the next argument is only its value if it is a boolean
+            value = "true";
+            if ((i + 1 < argc) && parseBool(argv[i + 1], flag)) {
+                value = argv[++i];
+            }
+        } else if (i + 1 < argc) {
+            value = argv[++i];
+        }
+        if (!config.set(key, value)) {
+            return std::nullopt;
+        }
+    }
+    return config;
+}
+
+/**
+ * @brief Prints the list of options.
+ */
+void Config::printUsage() {
+    std::println("usage: finances [--option=value | --option value | --bool-option]...");
+    std::println("       finances query FILE [--profile N] [--months A:B] QUERY...");
+    std::println("       finances report [--threads N] [--json BOOL] FILE...");
+    std::println("       finances merge [--json BOOL] SHARD...");
+    std::println("       finances export FILE CSV");
+    std::println("  --config FILE                    read key=value options from FILE");
+    std::println("  --debts FILE                     debt CSV of at most 64 debts (default ../debt.csv)");
+    std::println("  --portfolios DIR|FILE            batch mode: every .csv in DIR, or every path listed in FILE; each");
+    std::println("                                   of at most 64 debts");
+    std::println("  --iterations N                   trajectories to simulate (default 1048576)");
+    std::println("  --target-ci X                    stop early once every 95% CI is within +-X of its mean, e.g.");
+    std::println("                                   0.0001; --iterations is then the cap (default 0 = off)");
+    std::println("  --confidence X                   confidence level of --target-ci (default 0.95)");
+    std::println("  --min-iterations N               first round of --target-ci (default 16384)");
+    std::println("  --kid BOOL                       stop once only the kid debt is left (default true)");
+    std::println("  --aggressive BOOL                pay freed-up forced payments into other debts (default true)");
+    std::println("  --aggressive-offset X            added to the payment range if aggressive, at least 0 (default 475)");
+    std::println("  --payment-min X                  minimum monthly payment, at least 0 (default 2000)");
+    std::println("  --payment-max X                  maximum monthly payment, at least --payment-min (default 3000)");
+    std::println("  --payment-extra X                added to both ends of the payment range (default 0)");
+    std::println("  --payment-growth-rate X          payment range multiplier per promotion, at least 0 (default 0.5)");
+    std::println("  --payment-growth-frequency N     months between promotions (default 36)");
+    std::println("  --raises M:X,...                 one-off raises (or cuts): multiply the payment range by X from");
+    std::println("                                   month M on (default none)");
+    std::println("  --shock-probability P            chance per month of an income shock starting (default 0)");
+    std::println("  --shock-factor X                 fraction of the payment left during a shock, above 0 (default 0.5)");
+    std::println("  --shock-months N                 duration of a shock (default 6)");
+    std::println("  --max-periods N                  stop a trajectory that still has debt after N months and count it");
+    std::println("                                   as capped, at most 65535 (default 1200)");
+    std::println("  --strategy NAME                  avalanche, snowball, proportional or hybrid (default avalanche)");
+    std::println("  --hybrid-threshold X             largest balance paid smallest-first by hybrid (default 1000)");
+    std::println("  --sampling MODE                  payment draws: plain, antithetic, halton or stratified; prints the");
+    std::println("                                   variance reduction against plain Monte Carlo (default plain)");
+    std::println("  --sampling-months N              months drawn by halton or stratified, at most 64 (default 24)");
+    std::println("  --replicates N                   least number of independent blocks measuring the variance");
+    std::println("                                   reduction (default 16)");
+    std::println("  --seed N                         seed of every random stream; a seeded run is bit-identical for");
+    std::println("                                   any --threads (default random)");
+    std::println("  --shard K/N                      simulate only shard K (0 to N-1) of the run's blocks and write its");
+    std::println("                                   partial statistics to shard_K.bin; needs --seed (default 0/1)");
+    std::println("  --threads N                      worker threads, 0 = all cores (default 0)");
+    std::println("  --simd BOOL                      lane-parallel batch engine (default true)");
+    std::println("  --events BOOL                    event-driven scalar engine, skipping the periods in which only");
+    std::println("                                   the first debt is paid; overrides --simd (default false)");
+    std::println("  --write-results BOOL             write one raw row per iteration of each first cell");
+    std::println("  --result-format binary|csv       raw row format (default binary, indexed for finances query); csv");
+    std::println("                                   rows come in completion order, which varies with --threads");
+    std::println("  --record-every N                 record the month-by-month debt balances of every Nth iteration of");
+    std::println("                                   each block's first cell to trajectories.bin (default 0 = off)");
+    std::println("  --json BOOL                      print statistics as JSON (default false)");
+    std::println("  --sweep KEY=V1,V2,...            evaluate every combination of the listed values of scenario");
+    std::println("                                   KEY (or without=DEBT to drop a debt, none keeps all) and");
+    std::println("                                   print one table; repeat for more axes");
+    std::println("report prints the summary lines of each simulations.bin or simulations.csv FILE, parsed in parallel");
+    std::println("merge combines the shard_K.bin files of every shard of a run and prints what the unsharded run");
+    std::println("would have printed, bit for bit; the shards may come from different processes or machines");
+    std::println("export writes the rows of a binary simulations.bin FILE to CSV as \"totalPaid,periods\" lines, or");
+    std::println("the balances of a trajectories.bin FILE as \"profile,block,iteration,month,debt,balance\" lines");
+    std::println("queries of an indexed simulations.bin, answered without reading its rows:");
+    std::println("  count | mean | std               rows, mean and standard deviation of totalPaid and months");
+    std::println("  pQ                               percentile Q of totalPaid and months, e.g. p50 or p99.9");
+    std::println("  paid<X | months<N | months<=N    fraction of the rows below a threshold");
+    std::println("  --profile N                      profile of a batch run, in --portfolios order (default 0)");
+    std::println("  --months A:B                     only the rows paid off in A to B months (std excepted)");
+}
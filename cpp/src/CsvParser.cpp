@@ -1,38 +1,141 @@
 /**
- * @file CsvParser.hpp
- * @brief Defines a class for parsing CSV files into a 2D vector of strings.
+ * @file CsvParser.cpp
+ * @brief Implements the memory-mapped CSV parser.
  */
 
 #include "CsvParser.hpp"
 
-#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
 #include <iostream>
-#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
 
-[[nodiscard]] auto CsvParser::parse() const -> std::optional<std::vector<std::vector<std::string>>> {
-    std::ifstream file(file_path);
-    if (!file.is_open()) {
-        std::cerr << "Error: Could not open file: " << file_path << '\n';
-        return std::nullopt;
+/**
+ * @brief Constructs a CsvParser object and maps the file.
+ * @param file_path The path to the CSV file.
+ * @param delimiter The delimiter used in the file (default is ',').
+ */
+CsvParser::CsvParser(std::string file_path, char delimiter) : file_path(std::move(file_path)), delimiter(delimiter) {
+    int fd = ::open(this->file_path.c_str(), O_RDONLY);
+    struct stat st {};
+    if ((fd < 0) || (::fstat(fd, &st) != 0)) {
+        std::cerr << "Error: Could not open file: " << this->file_path << '\n';
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return;
     }
+    this->size = static_cast<size_t>(st.st_size);
+    this->opened = true;
+    if (this->size > 0) {
+        void* map = ::mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            std::cerr << "Error: Could not map file: " << this->file_path << '\n';
+            this->opened = false;
+            this->size = 0;
+        } else {
+            ::madvise(map, this->size, MADV_SEQUENTIAL);
+            this->data = static_cast<const char*>(map);
+        }
+    }
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+}
 
-    std::vector<std::vector<std::string>> data;
-    std::string line;
-
-    while (std::getline(file, line)) {
-        std::istringstream line_stream(line);
-        std::vector<std::string> row;
-        std::string cell;
+CsvParser::~CsvParser() {
+    if (this->data != nullptr) {
+        ::munmap(const_cast<char*>(this->data), this->size);
+    }
+}
 
-        while (std::getline(line_stream, cell, delimiter)) {
-            row.push_back(cell);
+/**
+ * @brief Splits the next row into cells.
+ * @param pos Offset of the row in the file. Advanced past the row.
+ * @param line Physical line of the row. Advanced by the line breaks the row consumed, quoted ones included.
+ * @return False once the end of the file is reached.
+ */
+auto CsvParser::nextRow(size_t& pos, size_t& line) const -> bool {
+    if (pos >= this->size) {
+        return false;
+    }
+    this->cells.clear();
+    this->scratch.clear();
+    this->unescaped.clear();
+    const char* p = this->data + pos;
+    const char* end = this->data + this->size;
+    while (true) {
+        if ((p < end) && (*p == '"')) {
+            // Quoted cell: runs to the closing quote, "" is an escaped quote
+            const char* start = ++p;
+            const char* close = start;
+            bool escaped = false;
+            while ((close < end) && !((*close == '"') && ((close + 1 >= end) || (close[1] != '"')))) {
+                if (*close == '"') {
+                    escaped = true;
+                    close++;
+                }
+                line += (*close == '\n') ? 1 : 0;
+                close++;
+            }
+            if (!escaped) {
+                this->cells.emplace_back(start, close - start);
+            } else {
+                // The scratch buffer may still grow, so the view is only created once the row is complete
+                size_t first = this->scratch.size();
+                for (const char* c = start; c < close; c++) {
+                    this->scratch.push_back(*c);
+                    c += ((*c == '"') ? 1 : 0);
+                }
+                this->unescaped.push_back({this->cells.size(), first, this->scratch.size() - first});
+                this->cells.emplace_back();
+            }
+            p = (close < end) ? close + 1 : end;
+            // Anything between the closing quote and the delimiter is ignored
+            while ((p < end) && (*p != this->delimiter) && (*p != '\n')) {
+                p++;
+            }
+        } else {
+            const char* start = p;
+            while ((p < end) && (*p != this->delimiter) && (*p != '\n')) {
+                p++;
+            }
+            const char* last = p;
+            if ((last > start) && (last[-1] == '\r')) {
+                last--;
+            }
+            this->cells.emplace_back(start, last - start);
         }
-
-        data.push_back(std::move(row));
+        if ((p < end) && (*p == this->delimiter)) {
+            p++;
+            continue;
+        }
+        for (auto [cell, first, length] : this->unescaped) {
+            this->cells[cell] = std::string_view(this->scratch.data() + first, length);
+        }
+        line += (p < end) ? 1 : 0;
+        pos = static_cast<size_t>(((p < end) ? p + 1 : end) - this->data);
+        return true;
     }
+}
 
+/**
+ * @brief Parses the entire CSV file into a 2D vector of strings.
+ * @return A 2D vector containing rows and cells, or std::nullopt if the file cannot be opened.
+ */
+[[nodiscard]] auto CsvParser::parse() const -> std::optional<std::vector<std::vector<std::string>>> {
+    if (!this->opened) {
+        return std::nullopt;
+    }
+    std::vector<std::vector<std::string>> data;
+    forEachRow([&](std::span<const std::string_view> row, [[maybe_unused]] size_t line) {
+        data.emplace_back(row.begin(), row.end());
+        return true;
+    });
     return data;
-};
+}
@@ -1,5 +1,6 @@
 #include "Debt.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
@@ -12,12 +13,12 @@
  * @class Debt
  * @brief Represents a financial debt, including principal, interest rate, and payment tracking.
  */
-Debt::Debt(double p, double r, PERIOD_E i, std::string id, double minimumMonthlyPayment, int periodTaken) {
+Debt::Debt(double p, double r, PERIOD_E i, std::string_view id, double minimumMonthlyPayment, int periodTaken) {
     this->principal = p;
     this->rate = r;
     this->interestPeriod = i;
     this->totalPaid = 0.0;
-    this->id = id;
+    this->id = Ids::intern(id);
     this->periods = 0;
     this->periodTaken = periodTaken;
     this->minimumMonthlyPayment = minimumMonthlyPayment;
@@ -52,11 +53,27 @@ void Debt::accrue() {
     this->periods++;
     if (this->periodTaken <= this->periods) {
         if ((this->periods % periodsPerYear(this->interestPeriod)) == 0) {
-            this->principal = compoundTotal(this->principal, this->rate, 1);
+            this->principal *= (1.0 + this->rate);
         }
     }
 }
 
+/**
+ * @brief Advances the debt over k periods in which it only accrues and takes its forced minimum payment.
+ * @param k Number of periods to skip.
+ * @note The debt must not be paid off during those periods; the jump costs O(1) regardless of k.
+ */
+void Debt::fastForward(int k) {
+    int first = std::max(this->periods + 1, this->periodTaken);
+    int last = this->periods + k;
+    if (first <= last) {
+        this->principal = compoundRun(this->principal, 1.0 + this->rate, periodsPerYear(this->interestPeriod),
+                                      this->minimumMonthlyPayment, first, last);
+        this->totalPaid += this->minimumMonthlyPayment * (last - first + 1);
+    }
+    this->periods = last;
+}
+
 /**
  * @brief Makes a payment toward the debt.
  * @param payment Reference to the payment amount. Adjusted after the function.
@@ -80,7 +97,7 @@ void Debt::pay(double& payment) {
  * @brief Prints the current status of the debt.
  */
 void Debt::print() {
-    DEBT_PRINT("{}: ${} remaining at {:.2f}% per {} with ${} paid so far", this->id, this->principal,
+    DEBT_PRINT("{}: ${} remaining at {:.2f}% per {} with ${} paid so far", Ids::name(this->id), this->principal,
                this->rate * 100.0, printPeriod(this->interestPeriod), this->totalPaid);
 }
 
@@ -154,6 +171,49 @@ auto Debt::compoundTotal(double principal, double rate, int periods) -> double {
     return principal * std::pow(1.0 + rate, static_cast<double>(periods));
 }
 
+/**
+ * @brief Calculates, in closed form, the principal after a run of periods that each accrue at their
+ * compounding boundary and then take a fixed payment.
+ * @param principal Initial principal amount.
+ * @param growth Multiplier applied at each compounding boundary (1 + rate).
+ * @param interval Number of periods between compounding boundaries.
+ * @param payment Payment made every period, after accrual.
+ * @param first First period of the run.
+ * @param last Last period of the run (inclusive).
+ * @return Principal after period `last`.
+ */
+auto Debt::compoundRun(double principal, double growth, int interval, double payment, int first, int last)
+    -> double {
+    if (last < first) {
+        return principal;
+    }
+    // Boundaries are the multiples of interval within [first, last]
+    int firstBoundary = ((first + interval - 1) / interval) * interval;
+    int lastBoundary = (last / interval) * interval;
+    if (firstBoundary > last) {
+        return principal - (payment * (last - first + 1));
+    }
+
+    // Plain payments up to the first boundary, then the boundary period itself
+    principal -= payment * (firstBoundary - first);
+    principal = (principal * growth) - payment;
+
+    // Each further interval is the affine map P -> g * P - c, applied q times
+    int q = (lastBoundary - firstBoundary) / interval;
+    if (q > 0) {
+        double c = payment * ((growth * (interval - 1)) + 1.0);
+        if (growth == 1.0) {
+            principal -= c * q;
+        } else {
+            double gq = std::pow(growth, static_cast<double>(q));
+            principal = (gq * principal) - (c * (gq - 1.0) / (growth - 1.0));
+        }
+    }
+
+    // Plain payments after the last boundary
+    return principal - (payment * (last - lastBoundary));
+}
+
 /**
  * @brief Calculates the compounded interest over a number of periods.
  * @param principal Initial principal amount.
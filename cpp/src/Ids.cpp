@@ -0,0 +1,43 @@
+/**
+ * @file Ids.cpp
+ * @brief Implements the process-wide table of interned debt identifiers.
+ */
+
+#include "Ids.hpp"
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+
+std::mutex mutex;                                       ///< Guards the table.
+std::deque<std::string> names;                          ///< Identifier of each handle; elements never move.
+std::unordered_map<std::string_view, Ids::Id> handles;  ///< Handle of each identifier, keyed by views into names.
+
+}  // namespace
+
+/**
+ * @brief Interns an identifier.
+ * @param name Identifier.
+ * @return Its handle; equal names get equal handles.
+ */
+auto Ids::intern(std::string_view name) -> Id {
+    std::lock_guard lock(mutex);
+    if (auto it = handles.find(name); it != handles.end()) {
+        return it->second;
+    }
+    auto id = static_cast<Id>(names.size());
+    handles.emplace(names.emplace_back(name), id);
+    return id;
+}
+
+/**
+ * @brief Gets the identifier behind a handle.
+ * @param id Handle returned by intern().
+ * @return The identifier; the reference stays valid for the life of the process.
+ */
+auto Ids::name(Id id) -> const std::string& {
+    std::lock_guard lock(mutex);
+    return names[id];
+}
@@ -0,0 +1,28 @@
+/**
+ * @file IncomeModel.cpp
+ * @brief Implements the tabulation of the payment ranges.
+ */
+
+#include "IncomeModel.hpp"
+
+/**
+ * @brief Tabulates the payment ranges of a scenario.
+ * @param scenario Scenario defining the income.
+ */
+IncomeModel::IncomeModel(const Scenario& scenario)
+    : low(HORIZON),
+      width(HORIZON),
+      shockProbability(scenario.shockProbability),
+      shockFactor(scenario.shockFactor),
+      shockMonths(scenario.shockMonths) {
+    for (int m = 0; m < HORIZON; m++) {
+        auto [lo, hi] = scenario.getPayRange(m);
+        double raise = 1.0;
+        for (auto [month, multiplier] : scenario.raises) {
+            raise *= (month <= m) ? multiplier : 1.0;
+        }
+        auto i = static_cast<size_t>(m);
+        this->low[i] = lo * raise;
+        this->width[i] = (hi * raise) - this->low[i];
+    }
+}
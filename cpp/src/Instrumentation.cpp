@@ -0,0 +1,173 @@
+/**
+ * @file Instrumentation.cpp
+ * @brief Implements the summaries of the instrumentation and, if enabled, the counting global operator new.
+ */
+
+#include "Instrumentation.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <format>
+#include <new>
+
+// Out-of-line static initialization
+std::array<Instrumentation::Slot, Instrumentation::MAX_THREADS> Instrumentation::slots{};
+std::atomic<unsigned int> Instrumentation::used{0};
+
+/**
+ * @brief Sums the slots of every thread.
+ * @return Totals since the start of the process.
+ */
+auto Instrumentation::totals() -> Totals {
+    Totals res;
+    res.threads = std::min(used.load(std::memory_order_relaxed), MAX_THREADS);
+    for (unsigned int t = 0; t < res.threads; t++) {
+        const Slot& s = slots[t];
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            res.counts[c] += s.counts[c].load(std::memory_order_relaxed);
+        }
+        for (int p = 0; p < PHASE_COUNT; p++) {
+            res.calls[p] += s.calls[p].load(std::memory_order_relaxed);
+            res.cycles[p] += s.cycles[p].load(std::memory_order_relaxed);
+        }
+    }
+    return res;
+}
+
+/**
+ * @brief Formats the totals as a table: counters, then cycles per phase with their share and cost per call.
+ * @param totals Totals to format.
+ * @return Human-readable summary.
+ */
+auto Instrumentation::toString(const Totals& totals) -> std::string {
+    std::string res = std::format("instrumentation over {} threads\n", totals.threads);
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        res += std::format("  {:<14}{:>16}\n", printCounter(static_cast<COUNTER_E>(c)), totals.counts[c]);
+    }
+    uint64_t all = 0;
+    for (uint64_t cycles : totals.cycles) {
+        all += cycles;
+    }
+    res += std::format("  {:<14}{:>16}{:>16}{:>8}{:>12}\n", "phase", "calls", "cycles", "share", "per call");
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        if (totals.calls[p] == 0) {
+            continue;
+        }
+        double share = (all != 0) ? (100.0 * static_cast<double>(totals.cycles[p]) / static_cast<double>(all)) : 0.0;
+        double perCall = static_cast<double>(totals.cycles[p]) / static_cast<double>(totals.calls[p]);
+        res += std::format("  {:<14}{:>16}{:>16}{:>7.1f}%{:>12.1f}\n", printPhase(static_cast<PHASE_E>(p)),
+                           totals.calls[p], totals.cycles[p], share, perCall);
+    }
+    return res;
+}
+
+/**
+ * @brief Formats the totals as a JSON object.
+ * @param totals Totals to format.
+ * @return JSON object with "counters" and "phases".
+ */
+auto Instrumentation::toJson(const Totals& totals) -> std::string {
+    std::string res = std::format("{{\"threads\": {}, \"counters\": {{", totals.threads);
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        res += std::format("{}\"{}\": {}", (c > 0) ? ", " : "", printCounter(static_cast<COUNTER_E>(c)),
+                           totals.counts[c]);
+    }
+    res += "}, \"phases\": {";
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        res += std::format("{}\"{}\": {{\"calls\": {}, \"cycles\": {}}}", (p > 0) ? ", " : "",
+                           printPhase(static_cast<PHASE_E>(p)), totals.calls[p], totals.cycles[p]);
+    }
+    res += "}}";
+    return res;
+}
+
+/**
+ * @brief Converts a counter to a string.
+ * @param counter Counter.
+ * @return Name of the counter.
+ */
+auto Instrumentation::printCounter(COUNTER_E counter) -> std::string {
+    switch (counter) {
+        case COUNTER_CHUNKS:
+            return "chunks";
+        case COUNTER_STEALS:
+            return "steals";
+        case COUNTER_LOCK_WAITS:
+            return "lockWaits";
+        case COUNTER_TRAJECTORIES:
+            return "trajectories";
+        case COUNTER_MONTHS:
+            return "months";
+        case COUNTER_ALLOCATIONS:
+            return "allocations";
+        default:
+            return "unknown";
+    }
+}
+
+/**
+ * @brief Converts a phase to a string.
+ * @param phase Phase.
+ * @return Name of the phase.
+ */
+auto Instrumentation::printPhase(PHASE_E phase) -> std::string {
+    switch (phase) {
+        case PHASE_SCHEDULE:
+            return "schedule";
+        case PHASE_LOCK_WAIT:
+            return "lockWait";
+        case PHASE_COPY:
+            return "copy";
+        case PHASE_BATCH:
+            return "batch";
+        case PHASE_RESET:
+            return "reset";
+        case PHASE_DRAW:
+            return "draw";
+        case PHASE_ACCRUE:
+            return "accrue";
+        case PHASE_PAY:
+            return "pay";
+        case PHASE_RETIRE:
+            return "retire";
+        case PHASE_STATS:
+            return "stats";
+        case PHASE_SINK:
+            return "sink";
+        default:
+            return "unknown";
+    }
+}
+
+#if (INSTRUMENT)
+// Replacing the global operator new counts every allocation of the process; the array and nothrow forms forward to
+// these. The deletes stay out of line so GCC does not pair the inlined free() with the strings above.
+
+auto operator new(std::size_t size) -> void* {
+    Instrumentation::count(Instrumentation::COUNTER_ALLOCATIONS);
+    if (void* p = std::malloc((size != 0) ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+auto operator new(std::size_t size, std::align_val_t align) -> void* {
+    Instrumentation::count(Instrumentation::COUNTER_ALLOCATIONS);
+    auto a = static_cast<std::size_t>(align);
+    if (void* p = std::aligned_alloc(a, ((std::max<std::size_t>(size, 1) + a - 1) / a) * a)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void* p) noexcept { std::free(p); }
+
+[[gnu::noinline]] void operator delete(void* p, [[maybe_unused]] std::size_t size) noexcept { std::free(p); }
+
+[[gnu::noinline]] void operator delete(void* p, [[maybe_unused]] std::align_val_t align) noexcept { std::free(p); }
+
+[[gnu::noinline]] void operator delete(void* p, [[maybe_unused]] std::size_t size,
+                                       [[maybe_unused]] std::align_val_t align) noexcept {
+    std::free(p);
+}
+#endif
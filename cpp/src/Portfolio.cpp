@@ -0,0 +1,301 @@
+/**
+ * @file Portfolio.cpp
+ * @brief Implements the structure-of-arrays debt portfolio used by the simulation hot loop.
+ */
+
+#include "Portfolio.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <print>
+#include <stdexcept>
+
+#include "flags.hpp"
+
+/**
+ * @brief Builds a portfolio from parsed debts.
+ * @param debts Debts to include; at most MAX_DEBTS.
+ * @param strategy Strategy selecting the payment order.
+ * @param hybridThreshold Largest balance paid snowball-style by Strategy::STRATEGY_HYBRID.
+ */
+Portfolio::Portfolio(const std::vector<Debt>& debts, Strategy::STRATEGY_E strategy, double hybridThreshold) {
+    // sort into payment order
+    std::vector<Debt> sorted = debts;
+    Strategy::order(sorted, strategy, hybridThreshold);
+    build(sorted);
+}
+
+/**
+ * @brief Fills the parameters from debts already in payment order.
+ * @param sorted Debts in payment order; at most MAX_DEBTS.
+ */
+void Portfolio::build(const std::vector<Debt>& sorted) {
+    if (sorted.size() > MAX_DEBTS) {
+        throw std::length_error("Portfolio supports at most " + std::to_string(MAX_DEBTS) + " debts");
+    }
+
+    this->count = sorted.size();
+    for (size_t i = 0; i < this->count; i++) {
+        const Debt& d = sorted[i];
+        this->initialPrincipal.push_back(d.principal);
+        this->rate.push_back(d.rate);
+        this->growth.push_back(1.0 + d.rate);
+        this->minimumPayment.push_back(d.minimumMonthlyPayment);
+        this->periodTaken.push_back(d.periodTaken);
+        this->compoundInterval.push_back(Debt::periodsPerYear(d.interestPeriod));
+        this->ids.push_back(d.id);
+        this->initialMask |= (1ULL << i);
+        if (d.isForced()) {
+            this->forcedMask |= (1ULL << i);
+        }
+        if (Ids::name(d.id) == "kid") {
+            this->kidIndex = static_cast<int>(i);
+        }
+    }
+    this->principal.resize(this->count);
+    this->paid.resize(this->count);
+    reset();
+}
+
+/**
+ * @brief Restores the state of a fresh trajectory.
+ */
+void Portfolio::reset() {
+    std::memcpy(this->principal.data(), this->initialPrincipal.data(), this->count * sizeof(double));
+    std::memset(this->paid.data(), 0, this->count * sizeof(double));
+    this->active = this->initialMask;
+    this->periods = 0;
+}
+
+/**
+ * @brief Makes a payment toward one debt, with the same semantics as Debt::pay.
+ * @param i Debt index.
+ * @param payment Reference to the payment amount. Adjusted after the function.
+ */
+void Portfolio::pay(size_t i, double& payment) {
+    if (this->periodTaken[i] <= this->periods) {
+        if (payment > this->principal[i]) {
+            this->paid[i] += this->principal[i];
+            payment -= this->principal[i];
+            this->principal[i] = 0.0;
+        } else {
+            this->paid[i] += payment;
+            this->principal[i] -= payment;
+            payment = 0.0;
+        }
+    }
+}
+
+/**
+ * @brief Accrues interest on every debt for the next period.
+ */
+void Portfolio::accrue() {
+    this->periods++;
+    for (uint64_t m = this->active; m != 0; m &= m - 1) {
+        auto i = static_cast<size_t>(std::countr_zero(m));
+        if ((this->periodTaken[i] <= this->periods) && ((this->periods % this->compoundInterval[i]) == 0)) {
+            this->principal[i] *= this->growth[i];
+        }
+    }
+}
+
+/**
+ * @brief Advances the trajectory over k periods in which debts only accrue and take their forced payments.
+ * @param k Number of periods to skip.
+ * @note No debt may be paid off during those periods; the jump costs O(1) per debt regardless of k.
+ */
+void Portfolio::fastForward(int k) {
+    int last = this->periods + k;
+    for (uint64_t m = this->active; m != 0; m &= m - 1) {
+        auto i = static_cast<size_t>(std::countr_zero(m));
+        int first = std::max(this->periods + 1, this->periodTaken[i]);
+        if (first <= last) {
+            this->principal[i] = Debt::compoundRun(this->principal[i], this->growth[i], this->compoundInterval[i],
+                                                   this->minimumPayment[i], first, last);
+            this->paid[i] += this->minimumPayment[i] * (last - first + 1);
+        }
+    }
+    this->periods = last;
+}
+
+/**
+ * @brief Pays the minimum on every forced debt that has been taken.
+ * @param payment Reference to the payment amount. Reduced by the forced payments when Aggressive.
+ * @tparam Aggressive Payments freed from paid-off forced debts go into the other debts.
+ */
+template <bool Aggressive>
+void Portfolio::payForced([[maybe_unused]] double& payment) {
+    for (uint64_t m = this->active & this->forcedMask; m != 0; m &= m - 1) {
+        auto i = static_cast<size_t>(std::countr_zero(m));
+        double forced = this->minimumPayment[i];
+        pay(i, forced);
+        if constexpr (Aggressive) {
+            // Use payment towards forced debts
+            payment -= (this->minimumPayment[i] - forced);
+        }
+    }
+}
+
+template void Portfolio::payForced<true>(double& payment);
+template void Portfolio::payForced<false>(double& payment);
+
+/**
+ * @brief Pays non-forced debts in payment order, then forced debts early if money remains.
+ * @param payment Reference to the payment amount. Adjusted after the function.
+ * @tparam Proportional Split the payment in proportion to the balances instead of cascading it.
+ */
+template <bool Proportional>
+void Portfolio::payNonForced(double& payment) {
+    if constexpr (Proportional) {
+        // A payment below the total balance is split without paying anything off; otherwise it cascades below
+        double total = 0.0;
+        for (uint64_t m = this->active & ~this->forcedMask; m != 0; m &= m - 1) {
+            auto i = static_cast<size_t>(std::countr_zero(m));
+            total += (this->periodTaken[i] <= this->periods) ? this->principal[i] : 0.0;
+        }
+        if (payment < total) {
+            double share = payment / total;
+            for (uint64_t m = this->active & ~this->forcedMask; m != 0; m &= m - 1) {
+                auto i = static_cast<size_t>(std::countr_zero(m));
+                double part = this->principal[i] * share;
+                pay(i, part);
+            }
+            payment = 0.0;
+            return;
+        }
+    }
+
+    for (uint64_t m = this->active & ~this->forcedMask; m != 0; m &= m - 1) {
+        pay(static_cast<size_t>(std::countr_zero(m)), payment);
+        if (Debt::isBasicallyZero(payment)) {
+            return;
+        }
+    }
+
+    // If all non-forced debts are zero, pay off forced debts early
+    for (uint64_t m = this->active; m != 0; m &= m - 1) {
+        pay(static_cast<size_t>(std::countr_zero(m)), payment);
+    }
+}
+
+template void Portfolio::payNonForced<true>(double& payment);
+template void Portfolio::payNonForced<false>(double& payment);
+
+/**
+ * @brief Gets the next period in which the structure of the portfolio changes whatever the payments: a debt is
+ * taken, or an active debt crosses a compounding boundary.
+ * @return The period, or INT_MAX if there is none; every period before it is a candidate for payQuiet().
+ */
+auto Portfolio::nextEvent() const -> int {
+    int res = std::numeric_limits<int>::max();
+    for (uint64_t m = this->active; m != 0; m &= m - 1) {
+        auto i = static_cast<size_t>(std::countr_zero(m));
+        int interval = this->compoundInterval[i];
+        int boundary = std::max(this->periods + 1, this->periodTaken[i]);
+        boundary = ((boundary + interval - 1) / interval) * interval;
+        res = std::min(res, boundary);
+        if (this->periodTaken[i] > this->periods) {
+            res = std::min(res, this->periodTaken[i]);
+        }
+    }
+    return res;
+}
+
+/**
+ * @brief Simulates a period in which nothing is paid off, so only the forced debts and the first taken debt in
+ * payment order change; equivalent to accrue(), payForced(), payNonForced() and retirePaidOff() in such a period.
+ * @param payment Payment of the period.
+ * @return False, leaving the portfolio unchanged, if some debt could be paid off in the period.
+ * @tparam Aggressive Payments freed from paid-off forced debts go into the other debts.
+ * @note The next period must come before nextEvent(), and the strategy must cascade payments.
+ */
+template <bool Aggressive>
+auto Portfolio::payQuiet(double payment) -> bool {
+    int period = this->periods + 1;
+    uint64_t forced = 0;
+    for (uint64_t m = this->active & this->forcedMask; m != 0; m &= m - 1) {
+        auto i = static_cast<size_t>(std::countr_zero(m));
+        if (this->periodTaken[i] <= period) {
+            if ((this->minimumPayment[i] > this->principal[i]) ||
+                Debt::isBasicallyZero(this->principal[i] - this->minimumPayment[i])) {
+                return false;
+            }
+            forced |= (1ULL << i);
+            if constexpr (Aggressive) {
+                // Nothing is paid off, so the whole minimum comes out of the payment, as in payForced
+                payment -= (this->minimumPayment[i] - 0.0);
+            }
+        }
+    }
+
+    // The cascade stops at the first taken debt, unless a negligible payment ends it at an earlier, untaken one
+    uint64_t nonForced = this->active & ~this->forcedMask;
+    uint64_t taken = nonForced;
+    while ((taken != 0) && (this->periodTaken[static_cast<size_t>(std::countr_zero(taken))] > period)) {
+        taken &= taken - 1;
+    }
+    if ((taken == 0) || (Debt::isBasicallyZero(payment) && (taken != nonForced))) {
+        return false;
+    }
+    auto head = static_cast<size_t>(std::countr_zero(taken));
+    if ((payment > this->principal[head]) || Debt::isBasicallyZero(this->principal[head] - payment)) {
+        return false;
+    }
+
+    this->periods = period;
+    for (uint64_t m = forced; m != 0; m &= m - 1) {
+        auto i = static_cast<size_t>(std::countr_zero(m));
+        this->paid[i] += this->minimumPayment[i];
+        this->principal[i] -= this->minimumPayment[i];
+    }
+    this->paid[head] += payment;
+    this->principal[head] -= payment;
+    return true;
+}
+
+template auto Portfolio::payQuiet<true>(double payment) -> bool;
+template auto Portfolio::payQuiet<false>(double payment) -> bool;
+
+/**
+ * @brief Retires every debt whose principal reached zero.
+ * @param totalPaid Reference to the trajectory total. Increased by the amount paid toward each retired debt.
+ */
+void Portfolio::retirePaidOff(double& totalPaid) {
+    for (uint64_t m = this->active; m != 0; m &= m - 1) {
+        auto i = static_cast<size_t>(std::countr_zero(m));
+        if (Debt::isBasicallyZero(this->principal[i])) {
+            totalPaid += this->paid[i];
+            this->active &= ~(1ULL << i);
+            DEBUG_PRINT("{} paid off with {:.2f} USD", Ids::name(this->ids[i]), this->paid[i]);
+        }
+    }
+}
+
+/**
+ * @brief Calculates the total remaining principal of the active, taken debts.
+ * @return Total debt amount.
+ */
+auto Portfolio::getTotalDebt() const -> double {
+    double res = 0.0;
+    for (uint64_t m = this->active; m != 0; m &= m - 1) {
+        auto i = static_cast<size_t>(std::countr_zero(m));
+        res += (this->periodTaken[i] <= this->periods) ? this->principal[i] : 0.0;
+    }
+    return res;
+}
+
+/**
+ * @brief Calculates the total paid toward the active, taken debts.
+ * @return Total paid amount.
+ */
+auto Portfolio::getTotalPaid() const -> double {
+    double res = 0.0;
+    for (uint64_t m = this->active; m != 0; m &= m - 1) {
+        auto i = static_cast<size_t>(std::countr_zero(m));
+        res += (this->periodTaken[i] <= this->periods) ? this->paid[i] : 0.0;
+    }
+    return res;
+}
@@ -0,0 +1,94 @@
+/**
+ * @file Profile.cpp
+ * @brief Implements loading of client profiles.
+ */
+
+#include "Profile.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <print>
+#include <string_view>
+
+#include "CsvParser.hpp"
+#include "flags.hpp"
+
+/**
+ * @brief Parses a debt file.
+ * @param path Path of the debt file.
+ * @return Debts with yearly rates, or std::nullopt if the file cannot be read or parsed.
+ */
+auto Profile::loadDebts(const std::string& path) -> std::optional<std::vector<Debt>> {
+    CsvParser csv(path);
+    std::vector<Debt> debts;
+    // principal, month taken, yearly rate, minimum monthly payment, id
+    bool parsed = csv.forEachRecord<double, int, double, double, std::string_view>(
+        [&](double principal, int monthTaken, double rate, double minimumMonthlyPayment, std::string_view id) {
+            DEBUG_PRINT("{:.2f} {:.2f} {}", principal, rate, id);
+            debts.emplace_back(principal, rate, Debt::PERIOD_YEARLY, id, minimumMonthlyPayment,
+                               monthTaken);
+        });
+    if (!parsed) {
+        return std::nullopt;
+    }
+    return debts;
+}
+
+/**
+ * @brief Loads the profiles of a run: the single debt file, or every portfolio of a batch.
+ * @param config Configuration naming the debt file or the batch (a directory of .csv files or a manifest
+ *               listing one path per line, relative to the manifest).
+ * @return The profiles, or std::nullopt if a file cannot be read or parsed.
+ */
+auto Profile::loadAll(const Config& config) -> std::optional<std::vector<Profile>> {
+    namespace fs = std::filesystem;
+    std::vector<std::pair<std::string, std::string>> files;  // (name, path)
+    if (config.portfolios.empty()) {
+        files.emplace_back("simulations", config.debtFile);
+    } else if (fs::is_directory(config.portfolios)) {
+        for (const auto& entry : fs::directory_iterator(config.portfolios)) {
+            if (entry.is_regular_file() && (entry.path().extension() == ".csv")) {
+                files.emplace_back(entry.path().stem().string(), entry.path().string());
+            }
+        }
+        std::ranges::sort(files);
+    } else {
+        std::ifstream manifest(config.portfolios);
+        if (!manifest.is_open()) {
+            std::cerr << "Error: Could not open file: " << config.portfolios << '\n';
+            return std::nullopt;
+        }
+        fs::path dir = fs::path(config.portfolios).parent_path();
+        std::string line;
+        while (std::getline(manifest, line)) {
+            line = line.substr(0, line.find('#'));
+            line.erase(line.find_last_not_of(" \t\r") + 1);
+            line.erase(0, line.find_first_not_of(" \t"));
+            if (!line.empty()) {
+                fs::path path = fs::path(line).is_absolute() ? fs::path(line) : (dir / line);
+                files.emplace_back(line, path.string());
+            }
+        }
+    }
+    if (files.empty()) {
+        std::cerr << "Error: No portfolios in " << config.portfolios << '\n';
+        return std::nullopt;
+    }
+
+    std::vector<Profile> profiles;
+    profiles.reserve(files.size());
+    for (const auto& [name, path] : files) {
+        std::optional<std::vector<Debt>> debts = loadDebts(path);
+        if (!debts) {
+            return std::nullopt;
+        }
+        std::optional<Sweep> sweep = Sweep::build(config, *debts);
+        if (!sweep) {
+            return std::nullopt;
+        }
+        profiles.push_back({name, std::move(*sweep)});
+    }
+    return profiles;
+}
@@ -0,0 +1,241 @@
+/**
+ * @file Report.cpp
+ * @brief Implements the parallel aggregation of result files.
+ */
+
+#include "Report.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string_view>
+
+#include "ResultSink.hpp"
+
+namespace {
+
+/**
+ * @struct Mapping
+ * @brief A file mapped read-only for the duration of a report.
+ */
+struct Mapping {
+    const char* data = nullptr;  ///< Start of the mapping.
+    size_t size = 0;             ///< Size of the file in bytes.
+    bool binary = false;         ///< Written by BinaryResultSink rather than as text.
+    ResultFileHeader header;     ///< Layout of a binary file.
+
+    Mapping() = default;
+    Mapping(const Mapping&) = delete;
+    auto operator=(const Mapping&) -> Mapping& = delete;
+    ~Mapping() {
+        if (this->data != nullptr) {
+            ::munmap(const_cast<char*>(this->data), this->size);
+        }
+    }
+};
+
+/**
+ * @struct Piece
+ * @brief Range of one file parsed by one thread: bytes of a text file or rows of a binary one.
+ */
+struct Piece {
+    size_t file;     ///< Index of the file.
+    uint64_t begin;  ///< First byte (text) or row (binary).
+    uint64_t end;    ///< One past the last byte or row.
+};
+
+/**
+ * @brief Maps a result file and recognizes its format.
+ * @param path Path of the file.
+ * @param m Mapping to fill.
+ * @return True on success.
+ */
+auto map(const std::string& path, Mapping& m) -> bool {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    struct stat st {};
+    if ((fd < 0) || (::fstat(fd, &st) != 0)) {
+        std::cerr << "Error: Could not open file: " << path << '\n';
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return false;
+    }
+    m.size = static_cast<size_t>(st.st_size);
+    if (m.size > 0) {
+        void* p = ::mmap(nullptr, m.size, PROT_READ, MAP_PRIVATE, fd, 0);
+        m.data = (p != MAP_FAILED) ? static_cast<const char*>(p) : nullptr;
+    }
+    ::close(fd);
+    if ((m.size > 0) && (m.data == nullptr)) {
+        std::cerr << "Error: Could not map file: " << path << '\n';
+        return false;
+    }
+    if (m.data != nullptr) {
+        ::madvise(const_cast<char*>(m.data), m.size, MADV_SEQUENTIAL);
+    }
+    if (m.size >= sizeof(ResultFileHeader)) {
+        std::memcpy(&m.header, m.data, sizeof(m.header));
+        m.binary = (m.header.magic == ResultFileHeader::MAGIC);
+        if (m.binary && (m.header.periodsOffset + (m.header.count * sizeof(uint16_t)) > m.size)) {
+            std::cerr << "Error: Truncated results file: " << path << '\n';
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Parses a totalPaid field.
+ *
+ * Sinks write two decimals, so the common case is read as an integer number of cents; dividing it by 100 rounds
+ * exactly as std::from_chars would. Any other spelling falls back to std::from_chars.
+ * @param s Field.
+ * @param value Parsed value.
+ * @return True if the field is a number.
+ */
+auto parsePaid(std::string_view s, double& value) -> bool {
+    uint64_t cents = 0;
+    size_t i = 0;
+    for (; (i < s.size()) && (i < 15) && (s[i] >= '0') && (s[i] <= '9'); i++) {
+        cents = (cents * 10) + static_cast<uint64_t>(s[i] - '0');
+    }
+    if ((i > 0) && (s.size() == i + 3) && (s[i] == '.') && (s[i + 1] >= '0') && (s[i + 1] <= '9') &&
+        (s[i + 2] >= '0') && (s[i + 2] <= '9')) {
+        cents = (cents * 100) + static_cast<uint64_t>(((s[i + 1] - '0') * 10) + (s[i + 2] - '0'));
+        value = static_cast<double>(cents) / 100.0;
+        return true;
+    }
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+    return (ec == std::errc()) && (ptr == s.data() + s.size());
+}
+
+/**
+ * @brief Parses one "totalPaid,periods" line.
+ * @param line Line without its newline.
+ * @param r Parsed result.
+ * @return True if the line is well formed.
+ */
+auto parseLine(std::string_view line, TrajectoryResult& r) -> bool {
+    if (!line.empty() && (line.back() == '\r')) {
+        line.remove_suffix(1);
+    }
+    size_t comma = line.find(',');
+    if (comma == std::string_view::npos) {
+        return false;
+    }
+    std::string_view periods = line.substr(comma + 1);
+    auto [ptr, ec] = std::from_chars(periods.data(), periods.data() + periods.size(), r.periods);
+    return parsePaid(line.substr(0, comma), r.totalPaid) && (ec == std::errc()) &&
+           (ptr == periods.data() + periods.size());
+}
+
+/**
+ * @brief Cuts the files into pieces; text pieces start and end at line boundaries.
+ * @param files Mapped files.
+ * @return Pieces of every file, in file order.
+ */
+auto cut(const std::vector<std::unique_ptr<Mapping>>& files) -> std::vector<Piece> {
+    std::vector<Piece> res;
+    for (size_t f = 0; f < files.size(); f++) {
+        const Mapping& m = *files[f];
+        if (m.binary) {
+            for (uint64_t begin = 0; begin < m.header.count; begin += Report::PIECE_ROWS) {
+                res.push_back({f, begin, std::min(begin + Report::PIECE_ROWS, m.header.count)});
+            }
+            continue;
+        }
+        uint64_t begin = 0;
+        while (begin < m.size) {
+            uint64_t end = std::min<uint64_t>(begin + Report::PIECE_BYTES, m.size);
+            const void* nl = (end < m.size) ? std::memchr(m.data + end, '\n', m.size - end) : nullptr;
+            end = (nl != nullptr) ? static_cast<uint64_t>(static_cast<const char*>(nl) - m.data) + 1 : m.size;
+            res.push_back({f, begin, end});
+            begin = end;
+        }
+    }
+    return res;
+}
+
+}  // namespace
+
+/**
+ * @brief Summarizes result files.
+ * @param paths Result files: simulations.bin as written by BinaryResultSink, or "totalPaid,periods" lines.
+ * @param pool Threads to parse on.
+ * @return The summary of each file, or std::nullopt if a file cannot be read.
+ */
+auto Report::summarize(const std::vector<std::string>& paths, ThreadPool& pool)
+    -> std::optional<std::vector<ResultStats>> {
+    std::vector<std::unique_ptr<Mapping>> files;
+    for (const std::string& path : paths) {
+        files.push_back(std::make_unique<Mapping>());
+        if (!map(path, *files.back())) {
+            return std::nullopt;
+        }
+    }
+    std::vector<Piece> pieces = cut(files);
+
+    std::vector<ChunkStats> moments(pieces.size());
+    std::vector<std::vector<ResultStats>> counts(pool.size(), std::vector<ResultStats>(files.size()));
+    std::atomic<size_t> next{0};
+    std::atomic<uint64_t> malformed{0};
+    pool.run([&](unsigned int t) {
+        for (size_t k = next.fetch_add(1); k < pieces.size(); k = next.fetch_add(1)) {
+            const Piece& piece = pieces[k];
+            const Mapping& m = *files[piece.file];
+            ResultStats& stats = counts[t][piece.file];
+            auto add = [&](const TrajectoryResult& r) {
+                moments[k].paid.add(r.totalPaid);
+                moments[k].periods.add(static_cast<double>(r.periods));
+                stats.addCounts(r);
+            };
+            if (m.binary) {
+                const auto* paid = reinterpret_cast<const double*>(m.data + m.header.paidOffset);
+                const auto* periods = reinterpret_cast<const uint16_t*>(m.data + m.header.periodsOffset);
+                for (uint64_t i = piece.begin; i < piece.end; i++) {
+                    add({paid[i], periods[i]});
+                }
+                continue;
+            }
+            uint64_t bad = 0;
+            const char* end = m.data + piece.end;
+            for (const char* p = m.data + piece.begin; p < end;) {
+                const auto* nl = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+                const char* lineEnd = (nl != nullptr) ? nl : end;
+                std::string_view line(p, static_cast<size_t>(lineEnd - p));
+                TrajectoryResult r{};
+                if (parseLine(line, r)) {
+                    add(r);
+                } else if (!line.empty() && (line != "\r")) {
+                    bad++;
+                }
+                p = lineEnd + 1;
+            }
+            malformed += bad;
+        }
+    });
+    if (malformed > 0) {
+        std::cerr << "Warning: Skipped " << malformed << " malformed lines\n";
+    }
+
+    // Counts merge exactly in any order; moments are folded in piece order
+    std::vector<ResultStats> res(files.size());
+    for (size_t k = 0; k < pieces.size(); k++) {
+        res[pieces[k].file].paid.merge(moments[k].paid);
+        res[pieces[k].file].periods.merge(moments[k].periods);
+    }
+    for (const std::vector<ResultStats>& thread : counts) {
+        for (size_t f = 0; f < files.size(); f++) {
+            res[f].merge(thread[f]);
+        }
+    }
+    return res;
+}
@@ -0,0 +1,291 @@
+/**
+ * @file ResultSink.cpp
+ * @brief Implements the binary and text result sinks.
+ */
+
+#include "ResultSink.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <format>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+#include "Statistics.hpp"
+
+namespace {
+
+/**
+ * @brief Writes a whole buffer at an offset, retrying short writes.
+ * @param fd File descriptor.
+ * @param data Buffer to write.
+ * @param size Number of bytes.
+ * @param offset Byte offset in the file.
+ * @return True on success.
+ */
+auto pwriteAll(int fd, const void* data, size_t size, uint64_t offset) -> bool {
+    const auto* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = ::pwrite(fd, bytes, size, static_cast<off_t>(offset));
+        if (n <= 0) {
+            return false;
+        }
+        bytes += n;
+        size -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+/**
+ * @brief Reads a whole buffer from an offset, retrying short reads.
+ * @param fd File descriptor.
+ * @param data Buffer to fill.
+ * @param size Number of bytes.
+ * @param offset Byte offset in the file.
+ * @return True on success.
+ */
+auto preadAll(int fd, void* data, size_t size, uint64_t offset) -> bool {
+    auto* bytes = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t n = ::pread(fd, bytes, size, static_cast<off_t>(offset));
+        if (n <= 0) {
+            return false;
+        }
+        bytes += n;
+        size -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+}  // namespace
+
+/**
+ * @brief Closes the output file.
+ */
+BinaryResultSink::~BinaryResultSink() {
+    if (this->fd >= 0) {
+        ::close(this->fd);
+    }
+}
+
+/**
+ * @brief Creates the output file and preallocates room for every row.
+ * @param path Path of the output file.
+ * @param iterations Number of rows that will be written per profile.
+ * @param groups Number of profiles.
+ * @return The sink, or nullptr if the file cannot be created.
+ */
+auto BinaryResultSink::open(const std::string& path, uint64_t iterations, uint64_t groups)
+    -> std::unique_ptr<BinaryResultSink> {
+    int fd = ::open(path.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0644);
+    if (fd < 0) {
+        std::cerr << "Error: Could not open file: " << path << '\n';
+        return nullptr;
+    }
+
+    uint64_t count = iterations * groups;
+    ResultFileHeader header;
+    header.count = count;
+    header.groups = groups;
+    header.paidOffset = sizeof(ResultFileHeader);
+    header.periodsOffset = header.paidOffset + (count * sizeof(double));
+    uint64_t size = header.periodsOffset + (count * sizeof(uint16_t));
+    if ((::ftruncate(fd, static_cast<off_t>(size)) != 0) || !pwriteAll(fd, &header, sizeof(header), 0)) {
+        std::cerr << "Error: Could not allocate file: " << path << '\n';
+        ::close(fd);
+        return nullptr;
+    }
+    return std::unique_ptr<BinaryResultSink>(new BinaryResultSink(fd, header));
+}
+
+/**
+ * @brief Writes the results of consecutive iterations into their slots of each column.
+ * @param first Global index of results[0].
+ * @param results Results to write; periods must fit the uint16 column.
+ */
+void BinaryResultSink::write(uint64_t first, std::span<const TrajectoryResult> results) {
+    thread_local std::vector<double> paid;
+    thread_local std::vector<uint16_t> periods;
+    paid.resize(results.size());
+    periods.resize(results.size());
+    for (size_t i = 0; i < results.size(); i++) {
+        if ((results[i].periods < 0) || (results[i].periods > UINT16_MAX)) {
+            std::cerr << "Error: Result " << first + i << " has " << results[i].periods
+                      << " periods, more than the results file can hold\n";
+            this->failed = true;
+            return;
+        }
+        paid[i] = results[i].totalPaid;
+        periods[i] = static_cast<uint16_t>(results[i].periods);
+    }
+
+    bool ok = pwriteAll(this->fd, paid.data(), paid.size() * sizeof(double),
+                        this->header.paidOffset + (first * sizeof(double)));
+    ok = ok && pwriteAll(this->fd, periods.data(), periods.size() * sizeof(uint16_t),
+                         this->header.periodsOffset + (first * sizeof(uint16_t)));
+    if (!ok) {
+        std::cerr << "Error: Could not write results " << first << " to " << first + results.size() << '\n';
+        this->failed = true;
+    }
+}
+
+/**
+ * @brief Sorts the columns of each profile and appends the index, then publishes it in the header.
+ * @return True on success, false if a write failed or the index cannot be written.
+ */
+auto BinaryResultSink::close() -> bool {
+    // Rows that were never stored would be indexed as zeros, so a failed write leaves the file without an index
+    if (this->failed) {
+        ::close(this->fd);
+        this->fd = -1;
+        std::cerr << "Error: The results file is incomplete\n";
+        return false;
+    }
+    ResultFileHeader& h = this->header;
+    std::vector<double> paid(h.count);
+    std::vector<uint16_t> periods(h.count);
+    bool ok = preadAll(this->fd, paid.data(), paid.size() * sizeof(double), h.paidOffset) &&
+              preadAll(this->fd, periods.data(), periods.size() * sizeof(uint16_t), h.periodsOffset);
+    h.maxPeriods = periods.empty() ? 0 : *std::ranges::max_element(periods);
+
+    uint64_t rows = h.count / h.groups;
+    std::vector<ResultGroupIndex> index(h.groups);
+    std::vector<double> sorted(rows);
+    std::vector<double> byPeriods(rows);
+    std::vector<double> prefix(rows + 1);
+    std::vector<uint64_t> cumulative(h.maxPeriods + 2);
+    std::vector<uint64_t> next(h.maxPeriods + 1);
+    // The index table follows the periods column, and the sorted columns of each profile follow the table
+    h.indexOffset = (h.periodsOffset + (h.count * sizeof(uint16_t)) + 7) & ~uint64_t{7};
+    uint64_t offset = h.indexOffset + (h.groups * sizeof(ResultGroupIndex));
+    for (uint64_t g = 0; ok && (g < h.groups); g++) {
+        const double* p = paid.data() + (g * rows);
+        const uint16_t* q = periods.data() + (g * rows);
+        RunningStats paidStats;
+        RunningStats periodsStats;
+        std::ranges::fill(cumulative, 0);
+        for (uint64_t r = 0; r < rows; r++) {
+            paidStats.add(p[r]);
+            periodsStats.add(q[r]);
+            cumulative[q[r] + 1]++;
+        }
+        std::partial_sum(cumulative.begin(), cumulative.end(), cumulative.begin());
+
+        std::copy(p, p + rows, sorted.begin());
+        std::ranges::sort(sorted);
+        // Counting sort by periods, then each run of equal periods by totalPaid
+        std::copy(cumulative.begin(), cumulative.end() - 1, next.begin());
+        for (uint64_t r = 0; r < rows; r++) {
+            byPeriods[next[q[r]]++] = p[r];
+        }
+        for (uint64_t m = 0; m <= h.maxPeriods; m++) {
+            std::sort(byPeriods.begin() + static_cast<ptrdiff_t>(cumulative[m]),
+                      byPeriods.begin() + static_cast<ptrdiff_t>(cumulative[m + 1]));
+        }
+        prefix[0] = 0.0;
+        for (uint64_t r = 0; r < rows; r++) {
+            prefix[r + 1] = prefix[r] + byPeriods[r];
+        }
+
+        ResultGroupIndex& e = index[g];
+        e.paidMean = paidStats.mean();
+        e.paidStd = paidStats.stddev();
+        e.periodsMean = periodsStats.mean();
+        e.periodsStd = periodsStats.stddev();
+        e.sortedPaidOffset = offset;
+        e.byPeriodsOffset = e.sortedPaidOffset + (rows * sizeof(double));
+        e.prefixOffset = e.byPeriodsOffset + (rows * sizeof(double));
+        e.cumulativeOffset = e.prefixOffset + (prefix.size() * sizeof(double));
+        offset = e.cumulativeOffset + (cumulative.size() * sizeof(uint64_t));
+        ok = pwriteAll(this->fd, sorted.data(), rows * sizeof(double), e.sortedPaidOffset) &&
+             pwriteAll(this->fd, byPeriods.data(), rows * sizeof(double), e.byPeriodsOffset) &&
+             pwriteAll(this->fd, prefix.data(), prefix.size() * sizeof(double), e.prefixOffset) &&
+             pwriteAll(this->fd, cumulative.data(), cumulative.size() * sizeof(uint64_t), e.cumulativeOffset);
+    }
+    // The header goes last, so an interrupted run leaves a file without an index rather than a broken one
+    ok = ok && pwriteAll(this->fd, index.data(), index.size() * sizeof(ResultGroupIndex), h.indexOffset) &&
+         pwriteAll(this->fd, &h, sizeof(h), 0);
+    ok = (::close(this->fd) == 0) && ok;
+    this->fd = -1;
+    if (!ok) {
+        std::cerr << "Error: Could not index the results file\n";
+    }
+    return ok;
+}
+
+/**
+ * @brief Converts a binary results file to the text CSV format ("totalPaid,periods" per line).
+ * @param binaryPath Path of the binary results file.
+ * @param csvPath Path of the CSV file to write.
+ * @return True on success.
+ */
+auto BinaryResultSink::exportCsv(const std::string& binaryPath, const std::string& csvPath) -> bool {
+    std::ifstream input(binaryPath, std::ios_base::binary);
+    ResultFileHeader header;
+    if (!input.read(reinterpret_cast<char*>(&header), sizeof(header)) || (header.magic != ResultFileHeader::MAGIC)) {
+        std::cerr << "Error: Not a results file: " << binaryPath << '\n';
+        return false;
+    }
+    std::vector<double> paid(header.count);
+    std::vector<uint16_t> periods(header.count);
+    input.seekg(static_cast<std::streamoff>(header.paidOffset));
+    input.read(reinterpret_cast<char*>(paid.data()), static_cast<std::streamsize>(paid.size() * sizeof(double)));
+    input.seekg(static_cast<std::streamoff>(header.periodsOffset));
+    input.read(reinterpret_cast<char*>(periods.data()),
+               static_cast<std::streamsize>(periods.size() * sizeof(uint16_t)));
+    if (!input) {
+        std::cerr << "Error: Truncated results file: " << binaryPath << '\n';
+        return false;
+    }
+
+    std::ofstream output(csvPath, std::ios_base::binary);
+    std::string block;
+    for (uint64_t i = 0; i < header.count; i++) {
+        block += std::format("{:.2f},{}\n", paid[i], periods[i]);
+        if (block.size() > (1 << 20)) {
+            output << block;
+            block.clear();
+        }
+    }
+    output << block;
+    output.close();
+    if (!output) {
+        std::cerr << "Error: Could not write file: " << csvPath << '\n';
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Formats the results into one block and appends it to the file.
+ * @param first Global index of results[0] (unused; blocks are appended in completion order).
+ * @param results Results to write.
+ */
+void CsvResultSink::write([[maybe_unused]] uint64_t first, std::span<const TrajectoryResult> results) {
+    thread_local std::string block;
+    block.clear();
+    for (const auto& r : results) {
+        block += std::format("{:.2f},{}\n", r.totalPaid, r.periods);
+    }
+    std::lock_guard<InstrumentedMutex> lock(this->mutex);
+    this->file << block;
+}
+
+/**
+ * @brief Flushes and closes the output file.
+ * @return True if every block was written.
+ */
+auto CsvResultSink::close() -> bool {
+    this->file.close();
+    if (!this->file) {
+        std::cerr << "Error: Could not write file: " << this->path << '\n';
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,251 @@
+/**
+ * @file ResultStore.cpp
+ * @brief Implements the queries of the memory-mapped results file.
+ */
+
+#include "ResultStore.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+/**
+ * @brief Converts a quantile to a nearest rank, as Histogram::quantile does.
+ * @param q Quantile in [0, 1].
+ * @param n Number of values; at least 1.
+ * @return Rank in [1, n].
+ */
+auto rankOf(double q, uint64_t n) -> uint64_t {
+    return std::clamp<uint64_t>(static_cast<uint64_t>(std::ceil(q * static_cast<double>(n))), 1, n);
+}
+
+}  // namespace
+
+/**
+ * @brief Constructs a ResultStore around a mapped file.
+ * @param base Mapped file.
+ * @param size Size of the mapping in bytes.
+ */
+ResultStore::ResultStore(const uint8_t* base, size_t size) : base(base), size(size) {
+    std::memcpy(&this->header, base, sizeof(this->header));
+}
+
+/**
+ * @brief Unmaps the file.
+ */
+ResultStore::~ResultStore() { ::munmap(const_cast<uint8_t*>(this->base), this->size); }
+
+/**
+ * @brief Maps a results file.
+ * @param path Path of the file written by BinaryResultSink.
+ * @return The store, or nullptr if the file cannot be read or was never indexed.
+ */
+auto ResultStore::open(const std::string& path) -> std::unique_ptr<ResultStore> {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    struct stat st {};
+    if ((fd < 0) || (::fstat(fd, &st) != 0)) {
+        std::cerr << "Error: Could not open file: " << path << '\n';
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return nullptr;
+    }
+    auto size = static_cast<size_t>(st.st_size);
+    void* map = (size >= sizeof(ResultFileHeader)) ? ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        std::cerr << "Error: Not a results file: " << path << '\n';
+        return nullptr;
+    }
+    std::unique_ptr<ResultStore> res(new ResultStore(static_cast<const uint8_t*>(map), size));
+    const ResultFileHeader& h = res->header;
+    if ((h.magic != ResultFileHeader::MAGIC) || (h.groups == 0)) {
+        std::cerr << "Error: Not a results file: " << path << '\n';
+        return nullptr;
+    }
+    // The last profile's cumulative counts end the file
+    uint64_t table = h.indexOffset + (h.groups * sizeof(ResultGroupIndex));
+    if ((h.indexOffset == 0) || (table > size) ||
+        (res->summary(h.groups - 1).cumulativeOffset + ((h.maxPeriods + 2) * sizeof(uint64_t)) > size)) {
+        std::cerr << "Error: Results file was not indexed: " << path << '\n';
+        return nullptr;
+    }
+    return res;
+}
+
+/**
+ * @brief Clamps a periods range to the periods values of the file.
+ * @param range Periods range.
+ * @return First periods value and one past the last, both in [0, maxPeriods + 1].
+ */
+auto ResultStore::clamp(PeriodRange range) const -> std::pair<uint64_t, uint64_t> {
+    uint64_t lo = std::min(range.lo, this->header.maxPeriods + 1);
+    uint64_t end = std::min(range.hi, this->header.maxPeriods) + 1;
+    return {lo, std::max(lo, end)};
+}
+
+/**
+ * @brief Counts the rows of a periods range. O(1).
+ * @param group Profile.
+ * @param range Periods range.
+ * @return Number of rows.
+ */
+auto ResultStore::count(uint64_t group, PeriodRange range) const -> uint64_t {
+    auto [lo, end] = clamp(range);
+    std::span<const uint64_t> cum = cumulative(group);
+    return cum[end] - cum[lo];
+}
+
+/**
+ * @brief Gets the mean totalPaid of a periods range. O(1).
+ * @param group Profile.
+ * @param range Periods range.
+ * @return Mean totalPaid (0 if the range is empty).
+ */
+auto ResultStore::paidMean(uint64_t group, PeriodRange range) const -> double {
+    auto [lo, end] = clamp(range);
+    std::span<const uint64_t> cum = cumulative(group);
+    uint64_t n = cum[end] - cum[lo];
+    if (n == rows()) {
+        return summary(group).paidMean;
+    }
+    std::span<const double> prefix = column<double>(summary(group).prefixOffset, rows() + 1);
+    return (n != 0) ? ((prefix[cum[end]] - prefix[cum[lo]]) / static_cast<double>(n)) : 0.0;
+}
+
+/**
+ * @brief Gets the nearest-rank quantile of totalPaid. O(1), or O(log^2 n) per periods value of a range.
+ * @param group Profile.
+ * @param q Quantile in [0, 1].
+ * @param range Periods range.
+ * @return The quantile (0 if the range is empty).
+ */
+auto ResultStore::paidQuantile(uint64_t group, double q, PeriodRange range) const -> double {
+    auto [lo, end] = clamp(range);
+    std::span<const uint64_t> cum = cumulative(group);
+    uint64_t n = cum[end] - cum[lo];
+    if (n == 0) {
+        return 0.0;
+    }
+    uint64_t rank = rankOf(q, n);
+    std::span<const double> sorted = column<double>(summary(group).sortedPaidOffset, rows());
+    std::span<const double> byPeriods = column<double>(summary(group).byPeriodsOffset, rows());
+    if (n == rows()) {
+        return sorted[rank - 1];
+    }
+    if (end - lo == 1) {
+        return byPeriods[cum[lo] + rank - 1];
+    }
+    // The answer is one of the sorted values: the smallest one with at least `rank` rows of the range at or below it
+    auto atOrBelow = [&](double x) {
+        uint64_t res = 0;
+        for (uint64_t m = lo; m < end; m++) {
+            std::span<const double> run = byPeriods.subspan(cum[m], cum[m + 1] - cum[m]);
+            res += static_cast<uint64_t>(std::ranges::upper_bound(run, x) - run.begin());
+        }
+        return res;
+    };
+    uint64_t a = 0;
+    uint64_t b = rows() - 1;
+    while (a < b) {
+        uint64_t mid = a + ((b - a) / 2);
+        if (atOrBelow(sorted[mid]) >= rank) {
+            b = mid;
+        } else {
+            a = mid + 1;
+        }
+    }
+    return sorted[a];
+}
+
+/**
+ * @brief Gets the fraction of rows with totalPaid below a value. O(log n) per periods value of the range.
+ * @param group Profile.
+ * @param x Threshold.
+ * @param range Periods range.
+ * @return P(totalPaid < x) within the range (0 if the range is empty).
+ */
+auto ResultStore::paidBelow(uint64_t group, double x, PeriodRange range) const -> double {
+    auto [lo, end] = clamp(range);
+    std::span<const uint64_t> cum = cumulative(group);
+    uint64_t n = cum[end] - cum[lo];
+    if (n == 0) {
+        return 0.0;
+    }
+    uint64_t below = 0;
+    if (n == rows()) {
+        std::span<const double> sorted = column<double>(summary(group).sortedPaidOffset, rows());
+        below = static_cast<uint64_t>(std::ranges::lower_bound(sorted, x) - sorted.begin());
+    } else {
+        std::span<const double> byPeriods = column<double>(summary(group).byPeriodsOffset, rows());
+        for (uint64_t m = lo; m < end; m++) {
+            std::span<const double> run = byPeriods.subspan(cum[m], cum[m + 1] - cum[m]);
+            below += static_cast<uint64_t>(std::ranges::lower_bound(run, x) - run.begin());
+        }
+    }
+    return static_cast<double>(below) / static_cast<double>(n);
+}
+
+/**
+ * @brief Gets the mean periods of a periods range. O(1), or O(1) per periods value of the range.
+ * @param group Profile.
+ * @param range Periods range.
+ * @return Mean periods (0 if the range is empty).
+ */
+auto ResultStore::periodsMean(uint64_t group, PeriodRange range) const -> double {
+    auto [lo, end] = clamp(range);
+    std::span<const uint64_t> cum = cumulative(group);
+    uint64_t n = cum[end] - cum[lo];
+    if (n == rows()) {
+        return summary(group).periodsMean;
+    }
+    double sum = 0.0;
+    for (uint64_t m = lo; m < end; m++) {
+        sum += static_cast<double>(m) * static_cast<double>(cum[m + 1] - cum[m]);
+    }
+    return (n != 0) ? (sum / static_cast<double>(n)) : 0.0;
+}
+
+/**
+ * @brief Gets the nearest-rank quantile of periods. O(log m) for m distinct periods values.
+ * @param group Profile.
+ * @param q Quantile in [0, 1].
+ * @param range Periods range.
+ * @return The quantile (0 if the range is empty).
+ */
+auto ResultStore::periodsQuantile(uint64_t group, double q, PeriodRange range) const -> uint64_t {
+    auto [lo, end] = clamp(range);
+    std::span<const uint64_t> cum = cumulative(group);
+    uint64_t n = cum[end] - cum[lo];
+    if (n == 0) {
+        return 0;
+    }
+    // Position of the rank in byPeriods order; its periods value is the last m with cum[m] <= position
+    uint64_t position = cum[lo] + rankOf(q, n) - 1;
+    return static_cast<uint64_t>(std::ranges::upper_bound(cum, position) - cum.begin()) - 1;
+}
+
+/**
+ * @brief Gets the fraction of rows paid off in fewer than a number of periods. O(1).
+ * @param group Profile.
+ * @param n Threshold.
+ * @param range Periods range.
+ * @return P(periods < n) within the range (0 if the range is empty).
+ */
+auto ResultStore::periodsBelow(uint64_t group, uint64_t n, PeriodRange range) const -> double {
+    auto [lo, end] = clamp(range);
+    std::span<const uint64_t> cum = cumulative(group);
+    uint64_t total = cum[end] - cum[lo];
+    if (total == 0) {
+        return 0.0;
+    }
+    return static_cast<double>(cum[std::clamp(n, lo, end)] - cum[lo]) / static_cast<double>(total);
+}
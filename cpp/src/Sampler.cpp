@@ -0,0 +1,59 @@
+/**
+ * @file Sampler.cpp
+ * @brief Implements the payment draw samplers.
+ */
+
+#include "Sampler.hpp"
+
+#include <algorithm>
+
+/**
+ * @brief Constructs a Sampler positioned at the first trajectory of a block.
+ * @param seed Global seed of the run.
+ * @param stream Block, selecting the random stream and the randomization of the sequences.
+ * @param mode Sampling scheme.
+ * @param months Months covered by halton or stratified sampling, at most MAX_MONTHS.
+ */
+Sampler::Sampler(uint64_t seed, uint64_t stream, MODE_E mode, int months)
+    // The layout stream uses the one trajectory index no block ever reaches
+    : rng(seed, stream), layout(seed, stream, UINT64_MAX), mode(mode), months(std::clamp(months, 0, MAX_MONTHS)) {
+    if (mode == MODE_HALTON) {
+        for (int d = 0; d < this->months; d++) {
+            this->shift[d] = CounterRng::toUniform(this->layout.at(d));
+        }
+    }
+}
+
+/**
+ * @brief Parses a sampling scheme name.
+ * @param s Name (plain, antithetic, halton or stratified).
+ * @return The scheme, or std::nullopt if unknown.
+ */
+auto Sampler::fromString(std::string_view s) -> std::optional<MODE_E> {
+    for (int m = 0; m < MODE_COUNT; m++) {
+        if (s == printMode(static_cast<MODE_E>(m))) {
+            return static_cast<MODE_E>(m);
+        }
+    }
+    return std::nullopt;
+}
+
+/**
+ * @brief Converts a sampling scheme to a string.
+ * @param mode Scheme.
+ * @return String representation of the scheme.
+ */
+auto Sampler::printMode(MODE_E mode) -> std::string {
+    switch (mode) {
+        case MODE_PLAIN:
+            return "plain";
+        case MODE_ANTITHETIC:
+            return "antithetic";
+        case MODE_HALTON:
+            return "halton";
+        case MODE_STRATIFIED:
+            return "stratified";
+        default:
+            return "invalid";
+    }
+}
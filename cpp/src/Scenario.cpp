@@ -0,0 +1,39 @@
+/**
+ * @file Scenario.cpp
+ * @brief Implements the scenario parameters.
+ */
+
+#include "Scenario.hpp"
+
+#include <cmath>
+#include <iostream>
+
+/**
+ * @brief Calculates a range of payment amounts based on the simulation period.
+ * @param periods The current number of periods elapsed.
+ * @return A pair representing the minimum and maximum payment amounts.
+ */
+auto Scenario::getPayRange(int periods) const -> std::pair<double, double> {
+    double offset = this->paymentExtra + (this->aggressive ? this->aggressiveOffset : 0.0);
+    double growth = 1.0 + (this->paymentGrowthRate *
+                           std::floor((static_cast<double>(periods) / this->paymentGrowthFrequency)));
+    return {(this->paymentMin + offset) * growth, (this->paymentMax + offset) * growth};
+}
+
+/**
+ * @brief Checks the options that constrain each other, which Config::set sees one at a time.
+ * @return True if the payment range is ordered and starts at a non-negative payment; errors are reported on
+ * std::cerr.
+ */
+auto Scenario::validate() const -> bool {
+    if (this->paymentMin > this->paymentMax) {
+        std::cerr << "Error: payment-min " << this->paymentMin << " is above payment-max " << this->paymentMax << '\n';
+        return false;
+    }
+    if (getPayRange(0).first < 0.0) {
+        std::cerr << "Error: The payment range starts below zero; payment-extra " << this->paymentExtra
+                  << " is too negative\n";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,98 @@
+/**
+ * @file Scheduler.cpp
+ * @brief Implements the chunked work-stealing scheduler.
+ */
+
+#include "Scheduler.hpp"
+
+#include <algorithm>
+
+#include "Instrumentation.hpp"
+
+/**
+ * @brief Constructs a Scheduler.
+ * @param iterations Exact number of iterations to hand out (in total, counting earlier rounds).
+ * @param blocks Number of blocks (random streams) the iterations are split into.
+ * @param threads Number of threads taking chunks.
+ * @param chunkSize Maximum number of iterations per chunk.
+ * @param groups Number of groups running the iterations.
+ * @param done Iterations already simulated by an earlier round; every block resumes after its share of them.
+ * @param shard Shard whose blocks are handed out, in [0, shards).
+ * @param shards Number of shards the blocks are split into; at most `blocks`.
+ */
+Scheduler::Scheduler(uint64_t iterations, uint64_t blocks, unsigned int threads, int chunkSize, size_t groups,
+                     uint64_t done, uint64_t shard, uint64_t shards)
+    : deques(std::make_unique<Deque[]>(threads)), threads(threads) {
+    uint64_t first = 0;
+    uint64_t shardBegin = firstBlock(blocks, shards, shard);
+    uint64_t shardEnd = firstBlock(blocks, shards, shard + 1);
+    for (size_t g = 0; g < groups; g++) {
+        for (uint64_t b = 0; b < blocks; b++) {
+            auto size = static_cast<int>(blockSize(iterations, blocks, b));
+            // Blocks of other shards get no chunks but still count towards the global index of the next ones
+            bool owned = (b >= shardBegin) && (b < shardEnd);
+            for (int begin = owned ? static_cast<int>(blockSize(done, blocks, b)) : size; begin < size;
+                 begin += chunkSize) {
+                int end = std::min(size, begin + chunkSize);
+                this->chunks.push_back({g, b, begin, end, first + begin, this->chunks.size()});
+            }
+            first += size;
+        }
+    }
+    // Contiguous runs keep each thread on its own blocks until it has to steal
+    uint64_t total = this->chunks.size();
+    for (unsigned int t = 0; t < threads; t++) {
+        this->deques[t].front = (total * t) / threads;
+        this->deques[t].back = (total * (t + 1)) / threads;
+    }
+}
+
+/**
+ * @brief Takes the next chunk for a thread, stealing from another thread once its own deque is empty.
+ * @param thread Index of the calling thread.
+ * @return The chunk, or std::nullopt once every chunk has been handed out.
+ */
+auto Scheduler::next(unsigned int thread) -> std::optional<Chunk> {
+    INSTRUMENT_SCOPE(PHASE_SCHEDULE);
+    Deque& own = this->deques[thread];
+    while (true) {
+        {
+            std::lock_guard lock(own.mutex);
+            if (own.front < own.back) {
+                INSTRUMENT_COUNT(COUNTER_CHUNKS, 1);
+                return this->chunks[own.front++];
+            }
+        }
+
+        // Steal the back half of the fullest deque. Deques are scanned one lock at a time, so the victim is re-checked
+        // once both locks are held; a scan that races with another steal may miss chunks, but those still belong to
+        // a running thread and are never lost.
+        unsigned int victim = thread;
+        uint64_t most = 0;
+        for (unsigned int t = 0; t < this->threads; t++) {
+            if (t == thread) {
+                continue;
+            }
+            Deque& d = this->deques[t];
+            std::lock_guard lock(d.mutex);
+            if ((d.back - d.front) > most) {
+                most = d.back - d.front;
+                victim = t;
+            }
+        }
+        if (most == 0) {
+            return std::nullopt;
+        }
+        Deque& v = this->deques[victim];
+        std::scoped_lock lock(v.mutex, own.mutex);
+        uint64_t remaining = v.back - v.front;
+        if (remaining == 0) {
+            continue;
+        }
+        uint64_t stolen = (remaining + 1) / 2;
+        own.front = v.back - stolen;
+        own.back = v.back;
+        v.back -= stolen;
+        INSTRUMENT_COUNT(COUNTER_STEALS, 1);
+    }
+}
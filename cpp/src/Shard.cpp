@@ -0,0 +1,159 @@
+/**
+ * @file Shard.cpp
+ * @brief Implements the shard files of a run split across processes and their merge.
+ */
+
+#include "Shard.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string_view>
+
+/**
+ * @brief Writes the results of a shard.
+ * @param path Path of the shard file.
+ * @param res Results of simulate() run with Options::shard and Options::shards.
+ * @param options Options of the run, which every shard of it must share (see Config::options).
+ * @return True on success.
+ */
+auto Shard::write(const std::string& path, const Results& res, const std::string& options) -> bool {
+    std::string stats;
+    for (const ProfileResults& p : res.profiles) {
+        auto cells = static_cast<uint64_t>(p.stats.size());
+        stats.append(reinterpret_cast<const char*>(&cells), sizeof(cells));
+        for (size_t c = 0; c < p.stats.size(); c++) {
+            p.stats[c].save(stats);
+            p.replicates[c].save(stats);
+        }
+    }
+    ShardFileHeader header;
+    header.seed = res.seed;
+    header.iterations = res.iterations;
+    header.blocks = res.blocks;
+    header.shard = res.shard;
+    header.shards = res.shards;
+    header.groups = res.profiles.size();
+    header.optionsSize = options.size();
+    header.statsSize = stats.size();
+
+    std::ofstream file(path, std::ios_base::binary);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file << options << stats;
+    file.close();
+    if (!file) {
+        std::cerr << "Error: Could not write file: " << path << '\n';
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Merges every shard of a run.
+ * @param paths Shard files, one per shard, in any order.
+ * @param options Set to the options of the run.
+ * @return The results of the whole run, or std::nullopt if a file cannot be read or the shards do not make up
+ * one run.
+ */
+auto Shard::merge(const std::vector<std::string>& paths, std::string& options) -> std::optional<Results> {
+    Results res;
+    ShardFileHeader first;
+    std::vector<bool> seen;
+    // Smallest saved cell, which bounds the counts read from a file before anything is allocated for them
+    std::string emptyCell;
+    ResultStats().save(emptyCell);
+    ReplicateStats().save(emptyCell);
+    for (const std::string& path : paths) {
+        std::ifstream file(path, std::ios_base::binary);
+        if (!file.is_open()) {
+            std::cerr << "Error: Could not open file: " << path << '\n';
+            return std::nullopt;
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        std::string data = buffer.str();
+        ShardFileHeader header;
+        if (data.size() >= sizeof(header)) {
+            std::memcpy(&header, data.data(), sizeof(header));
+        }
+        if ((data.size() < sizeof(header)) || (header.magic != ShardFileHeader::MAGIC) ||
+            (header.shard >= header.shards) || (header.optionsSize > data.size() - sizeof(header)) ||
+            (header.statsSize != data.size() - sizeof(header) - header.optionsSize)) {
+            std::cerr << "Error: Not a shard file: " << path << '\n';
+            return std::nullopt;
+        }
+        // Every profile starts with its number of cells
+        if ((header.shards > header.blocks) || (header.groups > header.statsSize / sizeof(uint64_t))) {
+            std::cerr << "Error: Corrupt shard file: " << path << '\n';
+            return std::nullopt;
+        }
+        if (header.shards > paths.size()) {
+            std::cerr << "Error: Run of " << header.shards << " shards, but only " << paths.size()
+                      << " shard files given: " << path << '\n';
+            return std::nullopt;
+        }
+        std::string_view text(data.data() + sizeof(header), header.optionsSize);
+        std::string_view stats(data.data() + sizeof(header) + header.optionsSize, header.statsSize);
+
+        // Every shard must come from the same run: same options, seed and split
+        if (seen.empty()) {
+            first = header;
+            options = text;
+            seen.assign(header.shards, false);
+            res.seed = header.seed;
+            res.iterations = header.iterations;
+            res.blocks = static_cast<unsigned int>(header.blocks);
+            res.profiles.resize(header.groups);
+        } else if ((header.seed != first.seed) || (header.iterations != first.iterations) ||
+                   (header.blocks != first.blocks) || (header.shards != first.shards) ||
+                   (header.groups != first.groups) || (text != options)) {
+            std::cerr << "Error: Shard is not from the same run as " << paths[0] << ": " << path << '\n';
+            return std::nullopt;
+        }
+        if (seen[header.shard]) {
+            std::cerr << "Error: Shard " << header.shard << " given twice: " << path << '\n';
+            return std::nullopt;
+        }
+        seen[header.shard] = true;
+
+        // Blocks belong to one shard each, so merging their moments copies them into place
+        for (ProfileResults& p : res.profiles) {
+            uint64_t cells = 0;
+            bool ok = (stats.size() >= sizeof(cells));
+            if (ok) {
+                std::memcpy(&cells, stats.data(), sizeof(cells));
+                stats.remove_prefix(sizeof(cells));
+                ok = (p.stats.empty() && (cells <= stats.size() / emptyCell.size())) || (cells == p.stats.size());
+            }
+            p.stats.resize(ok ? cells : 0);
+            p.deltas.resize(p.stats.size());
+            p.replicates.resize(p.stats.size());
+            for (size_t c = 0; ok && (c < p.stats.size()); c++) {
+                ResultStats s;
+                ReplicateStats r;
+                ok = s.load(stats) && r.load(stats);
+                p.stats[c].merge(s);
+                p.replicates[c].merge(r);
+            }
+            if (!ok) {
+                std::cerr << "Error: Corrupt shard file: " << path << '\n';
+                return std::nullopt;
+            }
+        }
+    }
+    for (size_t k = 0; k < seen.size(); k++) {
+        if (!seen[k]) {
+            std::cerr << "Error: Shard " << k << '/' << seen.size() << " is missing\n";
+            return std::nullopt;
+        }
+    }
+    if (seen.empty()) {
+        std::cerr << "Error: No shard files\n";
+        return std::nullopt;
+    }
+    for (ProfileResults& p : res.profiles) {
+        p.fold();
+    }
+    return res;
+}
@@ -0,0 +1,231 @@
+/**
+ * @file Simulation.cpp
+ * @brief Implements the library entry point: runs the rounds of a simulation on a thread pool.
+ */
+
+#include "Simulation.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+
+#include "Adaptive.hpp"
+#include "Scheduler.hpp"
+#include "Sweep.hpp"
+#include "Worker.hpp"
+#include "flags.hpp"
+
+namespace {
+
+/**
+ * @brief Folds the moments of every chunk of a finished round into the moments of its block, in chunk order.
+ * @param chunks Chunks of the round.
+ * @param chunkStats Moments of each chunk, one slot per cell.
+ * @param chunkSlots First slot of each chunk.
+ * @param res Results accumulating the rounds.
+ */
+void foldChunks(const std::vector<Chunk>& chunks, const std::vector<ChunkStats>& chunkStats,
+                const std::vector<size_t>& chunkSlots, Results& res) {
+    for (const Chunk& chunk : chunks) {
+        ProfileResults& p = res.profiles[chunk.group];
+        const ChunkStats* moments = chunkStats.data() + chunkSlots[chunk.index];
+        for (size_t c = 0; c < p.stats.size(); c++) {
+            p.replicates[c].merge(chunk.block, moments[c].paid, moments[c].periods, moments[c].delta);
+        }
+    }
+    for (ProfileResults& p : res.profiles) {
+        p.fold();
+    }
+}
+
+/**
+ * @brief Gets the widest relative confidence interval over the means of every cell of every profile.
+ * @param res Results of the finished rounds.
+ * @param adaptive Stopping rule defining the intervals.
+ * @param reduced Narrows the intervals by the variance reduction measured between the blocks.
+ * @return Largest relative half-width of the totalPaid and payoff months means.
+ */
+auto widestHalfWidth(const Results& res, const Adaptive& adaptive, bool reduced) -> double {
+    double widest = 0.0;
+    for (const ProfileResults& p : res.profiles) {
+        for (size_t c = 0; c < p.stats.size(); c++) {
+            double paidWidth = adaptive.halfWidth(p.stats[c].paid);
+            double periodsWidth = adaptive.halfWidth(p.stats[c].periods);
+            if (reduced) {
+                paidWidth /= std::sqrt(ReplicateStats::varianceReduction(p.replicates[c].paid));
+                periodsWidth /= std::sqrt(ReplicateStats::varianceReduction(p.replicates[c].periods));
+            }
+            widest = std::max({widest, paidWidth, periodsWidth});
+        }
+    }
+    return widest;
+}
+
+}  // namespace
+
+/**
+ * @brief Recomputes the moments of the stats and deltas of every cell from its blocks, in block order.
+ *
+ * Each block is simulated by exactly one process, so folding whole blocks in a fixed order gives the same moments
+ * whether the blocks were simulated in one run or merged from shards.
+ */
+void ProfileResults::fold() {
+    for (size_t c = 0; c < this->stats.size(); c++) {
+        const ReplicateStats& r = this->replicates[c];
+        this->stats[c].paid = RunningStats();
+        this->stats[c].periods = RunningStats();
+        this->deltas[c] = DeltaStats();
+        for (size_t b = 0; b < r.paid.size(); b++) {
+            this->stats[c].paid.merge(r.paid[b]);
+            this->stats[c].periods.merge(r.periods[b]);
+            this->deltas[c].merge(r.deltas[b]);
+        }
+    }
+}
+
+/**
+ * @brief Draws a seed from the system's entropy source.
+ * @return Random seed.
+ */
+auto Options::randomSeed() -> uint64_t {
+    return (static_cast<uint64_t>(std::random_device()()) << 32) | std::random_device()();
+}
+
+/**
+ * @brief Takes the run options of a command-line configuration.
+ * @param config Configuration.
+ * @return Options with the configured (or a random) seed and no pool, sink or recorder.
+ */
+auto Options::fromConfig(const Config& config) -> Options {
+    Options res;
+    res.threads = config.threads;
+    res.simd = config.simd;
+    res.events = config.events;
+    res.sampling = config.sampling;
+    res.samplingMonths = config.samplingMonths;
+    res.replicates = config.replicates;
+    res.targetCi = config.targetCi;
+    res.confidence = config.confidence;
+    res.minIterations = config.minIterations;
+    res.shard = config.shard;
+    res.shards = config.shards;
+    res.seed = config.seed.value_or(res.seed);
+    return res;
+}
+
+/**
+ * @brief Simulates every cell of every profile on common random numbers.
+ * @param profiles Profiles to simulate.
+ * @param iterations Iterations per cell; the cap when options.targetCi is set.
+ * @param options How to run the simulation.
+ * @return The statistics, or std::nullopt if the options are inconsistent.
+ */
+auto simulate(const std::vector<Profile>& profiles, uint64_t iterations, const Options& options)
+    -> std::optional<Results> {
+    if ((options.sink != nullptr) && (options.targetCi > 0.0)) {
+        std::cerr << "Error: Raw results cannot be written by an adaptive run\n";
+        return std::nullopt;
+    }
+    // Stopping early needs the intervals of the whole run, and raw rows of a shard would leave holes in the file
+    if ((options.shards > 1) && ((options.sink != nullptr) || (options.targetCi > 0.0))) {
+        std::cerr << "Error: A shard cannot write raw results or stop early\n";
+        return std::nullopt;
+    }
+
+    // Without an injected pool the threads live for this call only
+    std::unique_ptr<ThreadPool> ownPool;
+    ThreadPool* pool = options.pool;
+    if (pool == nullptr) {
+#if (DEBUG)
+        ownPool = std::make_unique<ThreadPool>(1);
+#else
+        ownPool = std::make_unique<ThreadPool>(options.threads);
+#endif
+        pool = ownPool.get();
+    }
+    unsigned int numWorkers = pool->size();
+    DEBUG_PRINT("simulating on {} threads", numWorkers);
+
+    Job job{&profiles,    nullptr,      nullptr,        nullptr,          options.sink,          options.recorder,
+            options.seed, options.simd, options.events, options.sampling, options.samplingMonths};
+    std::vector<Worker> workers;
+    workers.reserve(numWorkers);
+    for (unsigned int i = 0; i < numWorkers; i++) {
+        workers.emplace_back(i, job);
+    }
+
+    Results res;
+    res.seed = options.seed;
+    res.profiles.resize(profiles.size());
+    for (size_t g = 0; g < profiles.size(); g++) {
+        size_t numCells = profiles[g].sweep.getCells().size();
+        res.profiles[g].stats.resize(numCells);
+        res.profiles[g].deltas.resize(numCells);
+        res.profiles[g].replicates.resize(numCells);
+    }
+
+    // The blocks (random streams) and their chunks do not depend on the thread count, and the moments are folded in
+    // chunk order, then block order, so the results are bit-identical for any number of threads or shards.
+    // Variance-reduced sampling needs enough independent blocks to measure its own precision.
+    bool reduced = (options.sampling != Sampler::MODE_PLAIN);
+    unsigned int blocks = reduced ? std::max(options.blocks, options.replicates) : options.blocks;
+    if ((options.shards == 0) || (options.shards > blocks) || (options.shard >= options.shards)) {
+        std::cerr << "Error: Invalid shard " << options.shard << '/' << options.shards << " of " << blocks
+                  << " blocks\n";
+        return std::nullopt;
+    }
+    Adaptive adaptive(options.targetCi, options.confidence, iterations, options.minIterations);
+    uint64_t done = 0;
+    // One flat buffer of chunk moments, reused by every round
+    std::vector<ChunkStats> chunkStats;
+    std::vector<size_t> chunkSlots;
+    // Rounds extend the iterations until the stopping rule is met; without targetCi there is a single round
+    for (uint64_t total = adaptive.firstRound(); total > done;
+         total = adaptive.nextRound(done, widestHalfWidth(res, adaptive, reduced))) {
+        Scheduler scheduler(total, blocks, numWorkers, BATCH_CHUNK, profiles.size(), done, options.shard,
+                            options.shards);
+        size_t slots = 0;
+        chunkSlots.resize(scheduler.getChunks().size());
+        for (const Chunk& chunk : scheduler.getChunks()) {
+            chunkSlots[chunk.index] = slots;
+            slots += profiles[chunk.group].sweep.getCells().size();
+        }
+        chunkStats.assign(slots, ChunkStats{});
+        job.scheduler = &scheduler;
+        job.chunkStats = &chunkStats;
+        job.chunkSlots = &chunkSlots;
+        pool->run([&](unsigned int i) { workers[i].run(); });
+        foldChunks(scheduler.getChunks(), chunkStats, chunkSlots, res);
+        done = total;
+    }
+
+    res.iterations = done;
+    res.blocks = blocks;
+    res.shard = options.shard;
+    res.shards = options.shards;
+    res.widestHalfWidth = widestHalfWidth(res, adaptive, reduced);
+    // Histograms and sketches hold integer counts, so merging them in worker order is exact
+    for (size_t g = 0; g < profiles.size(); g++) {
+        for (const auto& w : workers) {
+            for (size_t c = 0; c < w.getStats()[g].size(); c++) {
+                res.profiles[g].stats[c].merge(w.getStats()[g][c]);
+            }
+        }
+    }
+    return res;
+}
+
+/**
+ * @brief Simulates one portfolio under one scenario.
+ * @param portfolio Debts to simulate, ordered by the scenario's strategy.
+ * @param scenario Scenario to simulate; its iterations are the iteration count.
+ * @param options How to run the simulation.
+ * @return The statistics of the single cell, or std::nullopt if the options are inconsistent.
+ */
+auto simulate(const Portfolio& portfolio, const Scenario& scenario, const Options& options) -> std::optional<Results> {
+    std::vector<Profile> profiles(1);
+    profiles[0].sweep = Sweep::single(scenario, portfolio);
+    return simulate(profiles, scenario.iterations, options);
+}
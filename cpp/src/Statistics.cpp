@@ -0,0 +1,524 @@
+/**
+ * @file Statistics.cpp
+ * @brief Implements mergeable streaming statistics.
+ */
+
+#include "Statistics.hpp"
+
+#include <cstring>
+#include <format>
+#include <print>
+#include <span>
+
+namespace {
+
+/**
+ * @brief Appends a trivially copyable value to a binary buffer.
+ * @param out Destination.
+ * @param v Value.
+ * @tparam T Type of the value.
+ */
+template <class T>
+void put(std::string& out, const T& v) {
+    out.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+/**
+ * @brief Reads a value written by put().
+ * @param in Source. Advanced past the value.
+ * @param v Destination.
+ * @return True if the source holds a whole value.
+ * @tparam T Type of the value.
+ */
+template <class T>
+auto get(std::string_view& in, T& v) -> bool {
+    if (in.size() < sizeof(v)) {
+        return false;
+    }
+    std::memcpy(&v, in.data(), sizeof(v));
+    in.remove_prefix(sizeof(v));
+    return true;
+}
+
+/**
+ * @brief Appends an array of counts, preceded by its size.
+ * @param out Destination.
+ * @param counts Counts.
+ */
+void putArray(std::string& out, std::span<const uint64_t> counts) {
+    put(out, static_cast<uint64_t>(counts.size()));
+    out.append(reinterpret_cast<const char*>(counts.data()), counts.size() * sizeof(uint64_t));
+}
+
+/**
+ * @brief Reads a vector of counts written by putArray().
+ * @param in Source. Advanced past the counts.
+ * @param counts Destination.
+ * @return True if the source holds every count.
+ */
+auto getArray(std::string_view& in, std::vector<uint64_t>& counts) -> bool {
+    uint64_t size = 0;
+    if (!get(in, size) || (size > in.size() / sizeof(uint64_t))) {
+        return false;
+    }
+    counts.resize(size);
+    std::memcpy(counts.data(), in.data(), size * sizeof(uint64_t));
+    in.remove_prefix(size * sizeof(uint64_t));
+    return true;
+}
+
+}  // namespace
+
+/**
+ * @brief Merges another accumulator into this one (Chan et al. pairwise update).
+ * @param o Accumulator to merge.
+ */
+void RunningStats::merge(const RunningStats& o) {
+    if (o.n == 0) {
+        return;
+    }
+    if (this->n == 0) {
+        *this = o;
+        return;
+    }
+    auto na = static_cast<double>(this->n);
+    auto nb = static_cast<double>(o.n);
+    double total = na + nb;
+    double d = o.mu - this->mu;
+    this->mu += d * nb / total;
+    this->m2 += o.m2 + (d * d * na * nb / total);
+    this->n += o.n;
+    this->lo = std::min(this->lo, o.lo);
+    this->hi = std::max(this->hi, o.hi);
+}
+
+/**
+ * @brief Appends the accumulator to a binary buffer.
+ * @param out Destination.
+ */
+void RunningStats::save(std::string& out) const {
+    put(out, this->n);
+    put(out, this->mu);
+    put(out, this->m2);
+    put(out, this->lo);
+    put(out, this->hi);
+}
+
+/**
+ * @brief Reads an accumulator written by save().
+ * @param in Source. Advanced past the accumulator.
+ * @return True on success; false if the buffer is truncated.
+ */
+auto RunningStats::load(std::string_view& in) -> bool {
+    return get(in, this->n) && get(in, this->mu) && get(in, this->m2) && get(in, this->lo) && get(in, this->hi);
+}
+
+/**
+ * @brief Makes sure bins [first, last] exist.
+ * @param first Lowest bin index needed.
+ * @param last Highest bin index needed.
+ */
+void Histogram::cover(int64_t first, int64_t last) {
+    if (this->counts.empty()) {
+        this->offset = first;
+        this->counts.assign(static_cast<size_t>(last - first + 1), 0);
+        return;
+    }
+    if (first < this->offset) {
+        this->counts.insert(this->counts.begin(), static_cast<size_t>(this->offset - first), 0);
+        this->offset = first;
+    }
+    auto end = this->offset + static_cast<int64_t>(this->counts.size());
+    if (last >= end) {
+        this->counts.resize(static_cast<size_t>(last - this->offset + 1), 0);
+    }
+}
+
+/**
+ * @brief Merges another histogram with the same bin width into this one.
+ * @param o Histogram to merge.
+ */
+void Histogram::merge(const Histogram& o) {
+    if (o.counts.empty()) {
+        return;
+    }
+    cover(o.offset, o.offset + static_cast<int64_t>(o.counts.size()) - 1);
+    for (size_t i = 0; i < o.counts.size(); i++) {
+        this->counts[static_cast<size_t>(o.offset - this->offset) + i] += o.counts[i];
+    }
+    this->n += o.n;
+}
+
+/**
+ * @brief Appends the histogram to a binary buffer.
+ * @param out Destination.
+ */
+void Histogram::save(std::string& out) const {
+    put(out, this->width);
+    put(out, this->offset);
+    put(out, this->n);
+    putArray(out, this->counts);
+}
+
+/**
+ * @brief Reads a histogram written by save(), bin width included.
+ * @param in Source. Advanced past the histogram.
+ * @return True on success; false if the buffer is truncated or inconsistent.
+ */
+auto Histogram::load(std::string_view& in) -> bool {
+    if (!get(in, this->width) || !get(in, this->offset) || !get(in, this->n) || !getArray(in, this->counts)) {
+        return false;
+    }
+    uint64_t total = 0;
+    for (uint64_t c : this->counts) {
+        total += c;
+    }
+    return (this->width > 0.0) && (total == this->n);
+}
+
+/**
+ * @brief Gets the nearest-rank quantile, reported as the lower edge of its bin.
+ * @param q Quantile in [0, 1].
+ * @return Quantile value; exact for integer data with unit bins.
+ */
+auto Histogram::quantile(double q) const -> double {
+    if (this->n == 0) {
+        return 0.0;
+    }
+    auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(this->n))));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < this->counts.size(); i++) {
+        seen += this->counts[i];
+        if (seen >= rank) {
+            return static_cast<double>(this->offset + static_cast<int64_t>(i)) * this->width;
+        }
+    }
+    return static_cast<double>(this->offset + static_cast<int64_t>(this->counts.size()) - 1) * this->width;
+}
+
+/**
+ * @brief Constructs an empty QuantileSketch.
+ * @param relativeAccuracy Maximum relative error of reported quantiles.
+ */
+QuantileSketch::QuantileSketch(double relativeAccuracy)
+    : gamma((1.0 + relativeAccuracy) / (1.0 - relativeAccuracy)), logGamma(std::log(gamma)) {}
+
+/**
+ * @brief Adds a sample.
+ * @param x Sample value.
+ */
+void QuantileSketch::add(double x) {
+    this->n++;
+    if (x <= 0.0) {
+        this->nonPositive++;
+        return;
+    }
+    auto bucket = static_cast<int64_t>(std::ceil(std::log(x) / this->logGamma));
+    auto size = static_cast<int64_t>(this->counts.size());
+    int64_t high = this->offset + size - 1;
+    if (this->counts.empty()) {
+        this->offset = bucket;
+        this->counts.push_back(0);
+    } else if (bucket < this->offset) {
+        // Leave as many free buckets below as are in use, so extending downwards is amortized O(1)
+        int64_t low = std::max(bucket - size, high - MAX_BUCKETS + 1);
+        if (low < this->offset) {
+            rebase(low, high);
+        }
+    } else if (bucket - this->offset >= MAX_BUCKETS) {
+        rebase(bucket - MAX_BUCKETS + 1, bucket);
+    } else if (bucket > high) {
+        this->counts.resize(static_cast<size_t>(bucket - this->offset + 1), 0);
+    }
+    // Below the kept range the sample is counted in the lowest bucket
+    bucket = std::max(bucket, this->offset);
+    this->counts[static_cast<size_t>(bucket - this->offset)]++;
+}
+
+/**
+ * @brief Moves the counts to buckets [low, high], counting the buckets below low in low.
+ * @param low New lowest bucket.
+ * @param high New highest bucket; at least the current one.
+ */
+void QuantileSketch::rebase(int64_t low, int64_t high) {
+    std::vector<uint64_t> moved(static_cast<size_t>(high - low + 1), 0);
+    for (size_t i = 0; i < this->counts.size(); i++) {
+        int64_t bucket = std::max(this->offset + static_cast<int64_t>(i), low);
+        moved[static_cast<size_t>(bucket - low)] += this->counts[i];
+    }
+    this->offset = low;
+    this->counts = std::move(moved);
+}
+
+/**
+ * @brief Merges another sketch with the same accuracy into this one.
+ * @param o Sketch to merge.
+ */
+void QuantileSketch::merge(const QuantileSketch& o) {
+    this->n += o.n;
+    this->nonPositive += o.nonPositive;
+    if (o.counts.empty()) {
+        return;
+    }
+    if (this->counts.empty()) {
+        this->offset = o.offset;
+        this->counts = o.counts;
+        return;
+    }
+    int64_t high = std::max(this->offset + static_cast<int64_t>(this->counts.size()),
+                            o.offset + static_cast<int64_t>(o.counts.size())) - 1;
+    int64_t low = std::max(std::min(this->offset, o.offset), high - MAX_BUCKETS + 1);
+    rebase(low, high);
+    for (size_t i = 0; i < o.counts.size(); i++) {
+        int64_t bucket = std::max(o.offset + static_cast<int64_t>(i), low);
+        this->counts[static_cast<size_t>(bucket - low)] += o.counts[i];
+    }
+}
+
+/**
+ * @brief Appends the sketch to a binary buffer.
+ * @param out Destination.
+ */
+void QuantileSketch::save(std::string& out) const {
+    // The free buckets left below by add() depend on the order of the samples, so they are not saved
+    auto first = static_cast<size_t>(std::ranges::find_if(this->counts, [](uint64_t c) { return c != 0; }) -
+                                     this->counts.begin());
+    put(out, this->gamma);
+    put(out, this->logGamma);
+    put(out, this->offset + static_cast<int64_t>(first));
+    put(out, this->nonPositive);
+    put(out, this->n);
+    putArray(out, std::span<const uint64_t>(this->counts).subspan(first));
+}
+
+/**
+ * @brief Reads a sketch written by save(), accuracy included.
+ * @param in Source. Advanced past the sketch.
+ * @return True on success; false if the buffer is truncated or inconsistent.
+ */
+auto QuantileSketch::load(std::string_view& in) -> bool {
+    if (!get(in, this->gamma) || !get(in, this->logGamma) || !get(in, this->offset) || !get(in, this->nonPositive) ||
+        !get(in, this->n) || !getArray(in, this->counts)) {
+        return false;
+    }
+    uint64_t total = this->nonPositive;
+    for (uint64_t c : this->counts) {
+        total += c;
+    }
+    return (this->gamma > 1.0) && (static_cast<int64_t>(this->counts.size()) <= MAX_BUCKETS) && (total == this->n);
+}
+
+/**
+ * @brief Gets the nearest-rank quantile.
+ * @param q Quantile in [0, 1].
+ * @return Quantile value, within the relative accuracy for positive samples.
+ */
+auto QuantileSketch::quantile(double q) const -> double {
+    if (this->n == 0) {
+        return 0.0;
+    }
+    auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(this->n))));
+    if (rank <= this->nonPositive) {
+        return 0.0;
+    }
+    uint64_t seen = this->nonPositive;
+    for (size_t i = 0; i < this->counts.size(); i++) {
+        seen += this->counts[i];
+        if (seen >= rank) {
+            // Bucket k covers (gamma^(k-1), gamma^k]; report the point with equal relative error to both bounds
+            auto k = static_cast<double>(this->offset + static_cast<int64_t>(i));
+            return 2.0 * std::pow(this->gamma, k) / (this->gamma + 1.0);
+        }
+    }
+    return 0.0;
+}
+
+/**
+ * @brief Merges another summary into this one.
+ * @param o Summary to merge.
+ */
+void ResultStats::merge(const ResultStats& o) {
+    this->paid.merge(o.paid);
+    this->periods.merge(o.periods);
+    this->paidHistogram.merge(o.paidHistogram);
+    this->periodsHistogram.merge(o.periodsHistogram);
+    this->paidSketch.merge(o.paidSketch);
+    this->capped += o.capped;
+}
+
+/**
+ * @brief Appends the summary to a binary buffer.
+ * @param out Destination.
+ */
+void ResultStats::save(std::string& out) const {
+    this->paid.save(out);
+    this->periods.save(out);
+    this->paidHistogram.save(out);
+    this->periodsHistogram.save(out);
+    this->paidSketch.save(out);
+    put(out, this->capped);
+}
+
+/**
+ * @brief Reads a summary written by save().
+ * @param in Source. Advanced past the summary.
+ * @return True on success; false if the buffer is truncated or inconsistent.
+ */
+auto ResultStats::load(std::string_view& in) -> bool {
+    return this->paid.load(in) && this->periods.load(in) && this->paidHistogram.load(in) &&
+           this->periodsHistogram.load(in) && this->paidSketch.load(in) && get(in, this->capped);
+}
+
+/**
+ * @brief Prints the summary line ("name mean +- std in mean +- std months") followed by the percentiles, and the
+ * number of capped trajectories if there are any.
+ * @param name Label printed at the start of the line.
+ */
+void ResultStats::print(const std::string& name) const {
+    std::println("{} {:.2f} +- {:.2f} in {:.2f} +- {:.2f} months", name, this->paid.mean(), this->paid.stddev(),
+                 this->periods.mean(), this->periods.stddev());
+    std::println("{} P50/P90/P99 {:.2f}/{:.2f}/{:.2f} in {}/{}/{} months", name, this->paidSketch.quantile(0.5),
+                 this->paidSketch.quantile(0.9), this->paidSketch.quantile(0.99), this->periodsHistogram.quantile(0.5),
+                 this->periodsHistogram.quantile(0.9), this->periodsHistogram.quantile(0.99));
+    if (this->capped > 0) {
+        std::println("{} {} of {} trajectories stopped at the period cap with debt left", name, this->capped,
+                     this->paid.count());
+    }
+}
+
+namespace {
+
+/**
+ * @brief Serializes a histogram as a JSON object.
+ * @param h Histogram.
+ * @return JSON text.
+ */
+auto histogramJson(const Histogram& h) -> std::string {
+    std::string res = std::format("{{\"width\": {}, \"start\": {}, \"counts\": [", h.getWidth(), h.getStart());
+    for (size_t i = 0; i < h.getCounts().size(); i++) {
+        res += std::format("{}{}", (i == 0) ? "" : ", ", h.getCounts()[i]);
+    }
+    return res + "]}";
+}
+
+}  // namespace
+
+/**
+ * @brief Quotes a string for JSON, escaping quotes, backslashes and control characters.
+ * @param s String to quote.
+ * @return JSON string literal, with the surrounding quotes.
+ */
+auto jsonString(std::string_view s) -> std::string {
+    std::string res = "\"";
+    for (char ch : s) {
+        if ((ch == '"') || (ch == '\\')) {
+            res += '\\';
+            res += ch;
+        } else if (static_cast<unsigned char>(ch) < 0x20) {
+            res += std::format("\\u{:04x}", static_cast<int>(ch));
+        } else {
+            res += ch;
+        }
+    }
+    return res + '"';
+}
+
+/**
+ * @brief Serializes the summary as a small JSON document.
+ * @return JSON text.
+ */
+auto ResultStats::toJson() const -> std::string {
+    std::string res = std::format("{{\"iterations\": {}, \"capped\": {},\n", this->paid.count(), this->capped);
+    res += std::format(
+        " \"totalPaid\": {{\"mean\": {:.2f}, \"std\": {:.2f}, \"min\": {:.2f}, \"max\": {:.2f}, \"p50\": {:.2f}, "
+        "\"p90\": {:.2f}, \"p99\": {:.2f}, \"histogram\": {}}},\n",
+        this->paid.mean(), this->paid.stddev(), this->paid.min(), this->paid.max(), this->paidSketch.quantile(0.5),
+        this->paidSketch.quantile(0.9), this->paidSketch.quantile(0.99), histogramJson(this->paidHistogram));
+    res += std::format(
+        " \"periods\": {{\"mean\": {:.2f}, \"std\": {:.2f}, \"min\": {}, \"max\": {}, \"p50\": {}, \"p90\": {}, "
+        "\"p99\": {}, \"histogram\": {}}}}}",
+        this->periods.mean(), this->periods.stddev(), this->periods.min(), this->periods.max(),
+        this->periodsHistogram.quantile(0.5), this->periodsHistogram.quantile(0.9),
+        this->periodsHistogram.quantile(0.99), histogramJson(this->periodsHistogram));
+    return res;
+}
+
+/**
+ * @brief Merges another accumulator into this one.
+ * @param o Accumulator to merge.
+ */
+void ReplicateStats::merge(const ReplicateStats& o) {
+    if (o.paid.size() > this->paid.size()) {
+        this->paid.resize(o.paid.size());
+        this->periods.resize(o.paid.size());
+        this->deltas.resize(o.paid.size());
+    }
+    for (size_t b = 0; b < o.paid.size(); b++) {
+        this->paid[b].merge(o.paid[b]);
+        this->periods[b].merge(o.periods[b]);
+        this->deltas[b].merge(o.deltas[b]);
+    }
+}
+
+/**
+ * @brief Appends the moments of every block to a binary buffer.
+ * @param out Destination.
+ */
+void ReplicateStats::save(std::string& out) const {
+    put(out, static_cast<uint64_t>(this->paid.size()));
+    for (size_t b = 0; b < this->paid.size(); b++) {
+        this->paid[b].save(out);
+        this->periods[b].save(out);
+        this->deltas[b].paid.save(out);
+        this->deltas[b].periods.save(out);
+    }
+}
+
+/**
+ * @brief Reads moments written by save().
+ * @param in Source. Advanced past the moments.
+ * @return True on success; false if the buffer is truncated or inconsistent.
+ */
+auto ReplicateStats::load(std::string_view& in) -> bool {
+    uint64_t blocks = 0;
+    if (!get(in, blocks) || (blocks > in.size())) {
+        return false;
+    }
+    this->paid.resize(blocks);
+    this->periods.resize(blocks);
+    this->deltas.resize(blocks);
+    for (size_t b = 0; b < blocks; b++) {
+        if (!this->paid[b].load(in) || !this->periods[b].load(in) || !this->deltas[b].paid.load(in) ||
+            !this->deltas[b].periods.load(in)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Gets the variance reduction factor of a mean: the variance plain Monte Carlo would have with the same
+ * number of trajectories, divided by the variance measured between the blocks.
+ * @param blocks Moments of each block.
+ * @return Variance reduction factor (1 for plain Monte Carlo, in expectation), or 1 with fewer than two blocks
+ * or a constant sample.
+ */
+auto ReplicateStats::varianceReduction(const std::vector<RunningStats>& blocks) -> double {
+    RunningStats all;
+    size_t used = 0;
+    for (const RunningStats& b : blocks) {
+        all.merge(b);
+        used += (b.count() > 0) ? 1 : 0;
+    }
+    if ((used < 2) || (all.variance() <= 0.0)) {
+        return 1.0;
+    }
+    // n_b (m_b - m)^2 estimates the variance of one trajectory's contribution to the mean, whatever the block sizes
+    double between = 0.0;
+    for (const RunningStats& b : blocks) {
+        double d = b.mean() - all.mean();
+        between += static_cast<double>(b.count()) * d * d;
+    }
+    between /= static_cast<double>(used - 1);
+    return all.variance() / between;
+}
@@ -0,0 +1,72 @@
+/**
+ * @file Strategy.cpp
+ * @brief Implements the payoff strategies.
+ */
+
+#include "Strategy.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+/**
+ * @brief Sorts debts into the payment order of a strategy.
+ * @param debts Debts to sort.
+ * @param strategy Strategy.
+ * @param hybridThreshold Largest balance paid snowball-style by STRATEGY_HYBRID.
+ */
+void Strategy::order(std::vector<Debt>& debts, STRATEGY_E strategy, double hybridThreshold) {
+    switch (strategy) {
+        case STRATEGY_SNOWBALL:
+            // Ordered once by initial balance: the debt being paid shrinks fastest, so the order rarely changes
+            // during a trajectory
+            order(debts, [](const Debt& a, const Debt& b) { return a.principal < b.principal; });
+            break;
+        case STRATEGY_HYBRID:
+            order(debts, [hybridThreshold](const Debt& a, const Debt& b) {
+                auto key = [hybridThreshold](const Debt& d) {
+                    return (d.principal <= hybridThreshold) ? d.principal : std::numeric_limits<double>::infinity();
+                };
+                return key(a) < key(b);
+            });
+            break;
+        default:
+            // Rate order only, the tie break of every strategy
+            std::ranges::sort(debts, std::ranges::greater(), &Debt::rate);
+            break;
+    }
+}
+
+/**
+ * @brief Parses a strategy name.
+ * @param name Name of the strategy.
+ * @return Strategy, or std::nullopt if the name is unknown.
+ */
+auto Strategy::fromString(std::string_view name) -> std::optional<STRATEGY_E> {
+    for (int s = 0; s < STRATEGY_COUNT; s++) {
+        if (name == printStrategy(static_cast<STRATEGY_E>(s))) {
+            return static_cast<STRATEGY_E>(s);
+        }
+    }
+    return std::nullopt;
+}
+
+/**
+ * @brief Converts a strategy to a string.
+ * @param strategy Strategy.
+ * @return String representation of the strategy.
+ */
+auto Strategy::printStrategy(STRATEGY_E strategy) -> std::string {
+    switch (strategy) {
+        case STRATEGY_AVALANCHE:
+            return "avalanche";
+        case STRATEGY_SNOWBALL:
+            return "snowball";
+        case STRATEGY_PROPORTIONAL:
+            return "proportional";
+        case STRATEGY_HYBRID:
+            return "hybrid";
+        default:
+            return "invalid";
+    }
+}
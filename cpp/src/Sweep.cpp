@@ -0,0 +1,238 @@
+/**
+ * @file Sweep.cpp
+ * @brief Implements the scenario grid.
+ */
+
+#include "Sweep.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <iostream>
+#include <print>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+/**
+ * @brief Scenario options that may be swept; output and run options stay fixed across cells.
+ */
+constexpr std::string_view SCENARIO_KEYS[] = {"kid",           "aggressive",          "aggressive-offset",
+                                              "payment-min",   "payment-max",         "payment-extra",
+                                              "payment-growth-rate", "payment-growth-frequency", "strategy",
+                                              "hybrid-threshold", "shock-probability", "shock-factor",
+                                              "shock-months", "max-periods"};
+
+/**
+ * @brief Splits a comma separated list.
+ * @param s List to split.
+ * @return Items of the list.
+ */
+auto splitList(const std::string& s) -> std::vector<std::string> {
+    std::vector<std::string> res;
+    size_t start = 0;
+    while (true) {
+        size_t comma = s.find(',', start);
+        res.push_back(s.substr(start, comma - start));
+        if (comma == std::string::npos) {
+            return res;
+        }
+        start = comma + 1;
+    }
+}
+
+/**
+ * @brief Standard error of a mean.
+ * @param s Accumulator.
+ * @return Standard deviation divided by the square root of the sample count.
+ */
+auto standardError(const RunningStats& s) -> double {
+    return (s.count() > 0) ? (s.stddev() / std::sqrt(static_cast<double>(s.count()))) : 0.0;
+}
+
+/**
+ * @brief Checks that the largest payment of the first month covers the interest of the debts taken by then.
+ *
+ * A payment below the interest can never pay the debts off, so such a trajectory would only stop at the period cap.
+ * @param cell Cell to check.
+ * @return True if the payment covers the interest, spread evenly over the months of each compounding interval.
+ */
+auto coversInterest(const Cell& cell) -> bool {
+    const Portfolio& p = cell.portfolio;
+    double interest = 0.0;
+    double payment = cell.income.getRange(0).second;
+    for (size_t i = 0; i < p.size(); i++) {
+        if (p.getPeriodTaken()[i] > 1) {
+            continue;
+        }
+        interest += p.getInitialPrincipal()[i] * p.getRate()[i] / p.getCompoundInterval()[i];
+        // Forced payments come on top of the payment unless they are part of it
+        if (!cell.scenario.aggressive && (((p.getForcedMask() >> i) & 1) != 0)) {
+            payment += p.getMinimumPayment()[i];
+        }
+    }
+    if (payment <= interest) {
+        std::cerr << std::format(
+            "Error: The largest payment {:.2f} does not cover the first month's interest {:.2f}, so the debts are "
+            "never paid off\n",
+            payment, interest);
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+/**
+ * @brief Expands the sweep axes of a configuration.
+ * @param config Configuration holding the base scenario and the axes.
+ * @param debts Parsed debts, before conversion to monthly rates.
+ * @return The sweep, or std::nullopt if an axis is invalid or the payments of a cell cannot cover its interest.
+ */
+auto Sweep::build(const Config& config, const std::vector<Debt>& debts) -> std::optional<Sweep> {
+    Sweep sweep;
+    std::vector<std::vector<std::string>> axes;
+    for (const std::string& spec : config.sweep) {
+        size_t eq = spec.find('=');
+        if (eq == std::string::npos) {
+            std::cerr << "Error: Sweep " << spec << " is not of the form key=v1,v2,...\n";
+            return std::nullopt;
+        }
+        std::string key = spec.substr(0, eq);
+        if ((key != "without") && (std::ranges::find(SCENARIO_KEYS, key) == std::end(SCENARIO_KEYS))) {
+            std::cerr << "Error: Cannot sweep over " << key << '\n';
+            return std::nullopt;
+        }
+        std::vector<std::string> values = splitList(spec.substr(eq + 1));
+        if (std::ranges::any_of(values, [](const std::string& v) { return v.empty(); })) {
+            std::cerr << "Error: Sweep " << spec << " has an empty value\n";
+            return std::nullopt;
+        }
+        sweep.keys.push_back(key);
+        axes.push_back(std::move(values));
+    }
+
+    size_t total = 1;
+    for (const auto& axis : axes) {
+        total *= axis.size();
+    }
+    for (size_t c = 0; c < total; c++) {
+        Config cellConfig = config;
+        std::vector<Debt> cellDebts = debts;
+        Cell cell;
+        // Row-major: the last axis varies fastest
+        size_t rest = c;
+        std::vector<size_t> index(axes.size());
+        for (size_t a = axes.size(); a-- > 0;) {
+            index[a] = rest % axes[a].size();
+            rest /= axes[a].size();
+        }
+        for (size_t a = 0; a < axes.size(); a++) {
+            const std::string& value = axes[a][index[a]];
+            cell.values.push_back(value);
+            if (sweep.keys[a] != "without") {
+                if (!cellConfig.set(sweep.keys[a], value)) {
+                    return std::nullopt;
+                }
+            } else if (value != "none") {
+                auto removed = std::erase_if(cellDebts, [&](const Debt& d) { return Ids::name(d.id) == value; });
+                if (removed == 0) {
+                    std::cerr << "Error: No debt named " << value << '\n';
+                    return std::nullopt;
+                }
+            }
+        }
+        cell.scenario = cellConfig.scenario;
+        if (!cell.scenario.validate()) {
+            return std::nullopt;
+        }
+        cell.income = IncomeModel(cell.scenario);
+        try {
+            cell.portfolio = Portfolio(cellDebts, cell.scenario.strategy, cell.scenario.hybridThreshold);
+        } catch (const std::length_error& e) {
+            std::cerr << "Error: " << e.what() << '\n';
+            return std::nullopt;
+        }
+        if (!coversInterest(cell)) {
+            return std::nullopt;
+        }
+        sweep.cells.push_back(std::move(cell));
+    }
+    return sweep;
+}
+
+/**
+ * @brief Builds a sweep without axes, the plain run of one scenario.
+ * @param scenario Scenario to simulate.
+ * @param portfolio Debts to simulate, ordered by the scenario's strategy.
+ * @return The sweep, with a single cell.
+ */
+auto Sweep::single(const Scenario& scenario, const Portfolio& portfolio) -> Sweep {
+    Sweep sweep;
+    sweep.cells.push_back({{}, scenario, IncomeModel(scenario), portfolio});
+    return sweep;
+}
+
+/**
+ * @brief Prints one row per cell with its statistics and its difference to the first cell.
+ * @param stats Statistics of each cell.
+ * @param deltas Difference of each cell to the first cell.
+ */
+void Sweep::printTable(const std::vector<ResultStats>& stats, const std::vector<DeltaStats>& deltas) const {
+    std::vector<size_t> widths;
+    std::string header;
+    for (size_t a = 0; a < this->keys.size(); a++) {
+        size_t w = this->keys[a].size();
+        for (const Cell& cell : this->cells) {
+            w = std::max(w, cell.values[a].size());
+        }
+        widths.push_back(w);
+        header += std::format("{:<{}}  ", this->keys[a], w);
+    }
+    std::println("{}{:>12} {:>9} {:>8} {:>6} {:>6} {:>20} {:>14}", header, "paid", "std", "P90", "months", "std",
+                 "d.paid +- se", "d.months +- se");
+    for (size_t c = 0; c < this->cells.size(); c++) {
+        std::string row;
+        for (size_t a = 0; a < this->keys.size(); a++) {
+            row += std::format("{:<{}}  ", this->cells[c].values[a], widths[a]);
+        }
+        const ResultStats& s = stats[c];
+        const DeltaStats& d = deltas[c];
+        std::println("{}{:>12.2f} {:>9.2f} {:>8.0f} {:>6.2f} {:>6.2f} {:>20} {:>14}", row, s.paid.mean(),
+                     s.paid.stddev(), s.paidSketch.quantile(0.9), s.periods.mean(), s.periods.stddev(),
+                     std::format("{:+.2f} +- {:.2f}", d.paid.mean(), standardError(d.paid)),
+                     std::format("{:+.2f} +- {:.2f}", d.periods.mean(), standardError(d.periods)));
+    }
+    for (size_t c = 0; c < this->cells.size(); c++) {
+        if (stats[c].capped > 0) {
+            std::println("cell {}: {} of {} trajectories stopped at the period cap with debt left", c, stats[c].capped,
+                         stats[c].paid.count());
+        }
+    }
+}
+
+/**
+ * @brief Serializes the statistics of every cell as a JSON array.
+ * @param stats Statistics of each cell.
+ * @param deltas Difference of each cell to the first cell.
+ * @return JSON text.
+ */
+auto Sweep::toJson(const std::vector<ResultStats>& stats, const std::vector<DeltaStats>& deltas) const
+    -> std::string {
+    std::string res = "[";
+    for (size_t c = 0; c < this->cells.size(); c++) {
+        res += (c == 0) ? "\n" : ",\n";
+        res += "{\"cell\": {";
+        for (size_t a = 0; a < this->keys.size(); a++) {
+            res += std::format("{}{}: {}", (a == 0) ? "" : ", ", jsonString(this->keys[a]),
+                               jsonString(this->cells[c].values[a]));
+        }
+        res += std::format(
+            "}},\n \"delta\": {{\"totalPaid\": {{\"mean\": {:.2f}, \"se\": {:.2f}}}, \"periods\": {{\"mean\": {:.2f}, "
+            "\"se\": {:.2f}}}}},\n \"stats\": {}}}",
+            deltas[c].paid.mean(), standardError(deltas[c].paid), deltas[c].periods.mean(),
+            standardError(deltas[c].periods), stats[c].toJson());
+    }
+    return res + "\n]";
+}
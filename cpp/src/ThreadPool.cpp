@@ -0,0 +1,72 @@
+/**
+ * @file ThreadPool.cpp
+ * @brief Implements the persistent thread pool.
+ */
+
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+/**
+ * @brief Starts the pool threads.
+ * @param size Number of threads; 0 means one per hardware thread.
+ */
+ThreadPool::ThreadPool(unsigned int size) {
+    size = (size != 0) ? size : std::max(1U, std::thread::hardware_concurrency());
+    for (unsigned int i = 0; i < size; i++) {
+        this->threads.emplace_back(&ThreadPool::loop, this, i);
+    }
+}
+
+/**
+ * @brief Stops and joins the pool threads.
+ */
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(this->mutex);
+        this->stopping = true;
+    }
+    this->wake.notify_all();
+    for (auto& t : this->threads) {
+        t.join();
+    }
+}
+
+/**
+ * @brief Body of a pool thread: waits for tasks and runs them until shutdown.
+ * @param index Index of the thread, passed to every task.
+ */
+void ThreadPool::loop(unsigned int index) {
+    uint64_t seen = 0;
+    while (true) {
+        const std::function<void(unsigned int)>* current = nullptr;
+        {
+            std::unique_lock lock(this->mutex);
+            this->wake.wait(lock, [&] { return this->stopping || (this->generation != seen); });
+            if (this->generation == seen) {
+                return;
+            }
+            seen = this->generation;
+            current = this->task;
+        }
+        (*current)(index);
+        std::lock_guard lock(this->mutex);
+        if (--this->running == 0) {
+            this->finished.notify_all();
+        }
+    }
+}
+
+/**
+ * @brief Runs task(i) on every pool thread i and returns once all of them have returned.
+ * @param task Task to run.
+ */
+void ThreadPool::run(const std::function<void(unsigned int)>& task) {
+    std::lock_guard serial(this->runMutex);
+    std::unique_lock lock(this->mutex);
+    this->task = &task;
+    this->running = size();
+    this->generation++;
+    this->wake.notify_all();
+    this->finished.wait(lock, [&] { return this->running == 0; });
+}
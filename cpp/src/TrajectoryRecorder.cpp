@@ -0,0 +1,274 @@
+/**
+ * @file TrajectoryRecorder.cpp
+ * @brief Implements the trajectory recorder and its CSV export.
+ */
+
+#include "TrajectoryRecorder.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+
+namespace {
+
+/**
+ * @brief Writes a whole buffer at an offset, retrying short writes.
+ * @param fd File descriptor.
+ * @param data Buffer to write.
+ * @param size Number of bytes.
+ * @param offset Byte offset in the file.
+ * @return True on success.
+ */
+auto pwriteAll(int fd, const void* data, size_t size, uint64_t offset) -> bool {
+    const auto* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = ::pwrite(fd, bytes, size, static_cast<off_t>(offset));
+        if (n <= 0) {
+            return false;
+        }
+        bytes += n;
+        size -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+/**
+ * @brief Appends a signed value as a zigzag varint.
+ * @param out Destination.
+ * @param v Value.
+ */
+void putVarint(std::vector<uint8_t>& out, int64_t v) {
+    uint64_t z = (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+    while (z >= 0x80) {
+        out.push_back(static_cast<uint8_t>(z | 0x80));
+        z >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(z));
+}
+
+/**
+ * @brief Reads a zigzag varint.
+ * @param p Read position. Advanced past the value.
+ * @param end End of the readable range.
+ * @return The value (0 if the range ends inside it).
+ */
+auto getVarint(const uint8_t*& p, const uint8_t* end) -> int64_t {
+    uint64_t z = 0;
+    for (int shift = 0; (p < end) && (shift < 64); shift += 7) {
+        uint8_t b = *p++;
+        z |= static_cast<uint64_t>(b & 0x7F) << shift;
+        if ((b & 0x80) == 0) {
+            break;
+        }
+    }
+    return static_cast<int64_t>(z >> 1) ^ -static_cast<int64_t>(z & 1);
+}
+
+}  // namespace
+
+/**
+ * @brief Encodes the trajectory being recorded.
+ * @param entry Description of the trajectory; its months, debts and offset are filled in.
+ */
+void TrajectoryRecorder::Buffer::end(TrajectoryEntry entry) {
+    size_t months = (this->debts != 0) ? (this->balances.size() / this->debts) : 0;
+    entry.months = static_cast<uint32_t>(months);
+    entry.debts = static_cast<uint32_t>(this->debts);
+    entry.offset = this->values.size();
+    // Column by column: consecutive months of one debt differ little, so their deltas stay short
+    for (size_t d = 0; d < this->debts; d++) {
+        int64_t previous = 0;
+        for (size_t m = 0; m < months; m++) {
+            auto cents = static_cast<int64_t>(std::llround(this->balances[(m * this->debts) + d] * 100.0));
+            putVarint(this->values, cents - previous);
+            previous = cents;
+        }
+    }
+    this->entries.push_back(entry);
+}
+
+/**
+ * @brief Constructs a TrajectoryRecorder around an open file.
+ * @param fd File descriptor of the output file.
+ * @param every Sampling interval.
+ * @param table Profile table.
+ */
+TrajectoryRecorder::TrajectoryRecorder(int fd, uint64_t every, std::string table)
+    : fd(fd), every(every), table(std::move(table)), end(sizeof(TrajectoryFileHeader)) {}
+
+/**
+ * @brief Closes the output file.
+ */
+TrajectoryRecorder::~TrajectoryRecorder() {
+    if (this->fd >= 0) {
+        ::close(this->fd);
+    }
+}
+
+/**
+ * @brief Creates the output file.
+ * @param path Path of the output file.
+ * @param every Records iterations i of each block with i % every == 0.
+ * @param profiles Profiles of the run; the debts of each profile's first cell are recorded.
+ * @return The recorder, or nullptr if the file cannot be created.
+ */
+auto TrajectoryRecorder::open(const std::string& path, uint64_t every, const std::vector<Profile>& profiles)
+    -> std::unique_ptr<TrajectoryRecorder> {
+    int fd = ::open(path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    if (fd < 0) {
+        std::cerr << "Error: Could not open file: " << path << '\n';
+        return nullptr;
+    }
+    std::string table;
+    for (const Profile& p : profiles) {
+        table += p.name;
+        for (Ids::Id id : p.sweep.getCells()[0].portfolio.getIds()) {
+            table += '\t' + Ids::name(id);
+        }
+        table += '\n';
+    }
+    return std::unique_ptr<TrajectoryRecorder>(new TrajectoryRecorder(fd, every, std::move(table)));
+}
+
+/**
+ * @brief Appends the buffer as one chunk and empties it. Safe to call concurrently from several workers.
+ * @param buffer Buffer to flush.
+ */
+void TrajectoryRecorder::flush(Buffer& buffer) {
+    if (buffer.entries.empty()) {
+        return;
+    }
+    buffer.values.resize((buffer.values.size() + 7) & ~size_t{7}, 0);
+    TrajectoryChunkHeader header{buffer.entries.size(), buffer.values.size()};
+    uint64_t entriesSize = buffer.entries.size() * sizeof(TrajectoryEntry);
+    uint64_t offset = this->end.fetch_add(sizeof(header) + entriesSize + buffer.values.size());
+
+    bool ok = pwriteAll(this->fd, &header, sizeof(header), offset);
+    ok = ok && pwriteAll(this->fd, buffer.entries.data(), entriesSize, offset + sizeof(header));
+    ok = ok && pwriteAll(this->fd, buffer.values.data(), buffer.values.size(), offset + sizeof(header) + entriesSize);
+    if (!ok) {
+        std::cerr << "Error: Could not write " << buffer.entries.size() << " trajectories\n";
+    }
+    this->chunks++;
+    this->trajectories += buffer.entries.size();
+    buffer.entries.clear();
+    buffer.values.clear();
+}
+
+/**
+ * @brief Writes the profile table and the header; call once every buffer has been flushed.
+ * @return True on success.
+ */
+auto TrajectoryRecorder::close() -> bool {
+    TrajectoryFileHeader header;
+    header.every = this->every;
+    header.chunks = this->chunks;
+    header.trajectories = this->trajectories;
+    header.tableOffset = this->end;
+    header.tableSize = this->table.size();
+    bool ok = pwriteAll(this->fd, this->table.data(), this->table.size(), header.tableOffset) &&
+              pwriteAll(this->fd, &header, sizeof(header), 0) && (::close(this->fd) == 0);
+    this->fd = -1;
+    if (!ok) {
+        std::cerr << "Error: Could not finish the trajectory file\n";
+    }
+    return ok;
+}
+
+/**
+ * @brief Converts a trajectory file to a long CSV ("profile,block,iteration,month,debt,balance" per line).
+ * @param path Path of the trajectory file.
+ * @param csvPath Path of the CSV file to write.
+ * @return True on success.
+ */
+auto TrajectoryRecorder::exportCsv(const std::string& path, const std::string& csvPath) -> bool {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    struct stat st {};
+    if ((fd < 0) || (::fstat(fd, &st) != 0)) {
+        std::cerr << "Error: Could not open file: " << path << '\n';
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return false;
+    }
+    auto size = static_cast<size_t>(st.st_size);
+    void* map = (size >= sizeof(TrajectoryFileHeader)) ? ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0)
+                                                       : MAP_FAILED;
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        std::cerr << "Error: Not a trajectory file: " << path << '\n';
+        return false;
+    }
+    const auto* base = static_cast<const uint8_t*>(map);
+    TrajectoryFileHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    if ((header.magic != TrajectoryFileHeader::MAGIC) || (header.tableOffset + header.tableSize > size)) {
+        std::cerr << "Error: Not a trajectory file: " << path << '\n';
+        ::munmap(map, size);
+        return false;
+    }
+
+    // Debt ids of every profile, from the tab-separated table
+    std::vector<std::vector<std::string>> ids;
+    std::string_view table(reinterpret_cast<const char*>(base + header.tableOffset), header.tableSize);
+    while (!table.empty()) {
+        std::string_view line = table.substr(0, table.find('\n'));
+        table.remove_prefix(std::min(table.size(), line.size() + 1));
+        std::vector<std::string>& row = ids.emplace_back();
+        for (size_t tab = line.find('\t'); tab != std::string_view::npos; tab = line.find('\t')) {
+            line.remove_prefix(tab + 1);
+            row.emplace_back(line.substr(0, line.find('\t')));
+        }
+    }
+
+    std::ofstream output(csvPath, std::ios_base::binary);
+    output << "profile,block,iteration,month,debt,balance\n";
+    std::string block;
+    bool ok = true;
+    for (uint64_t offset = sizeof(header), c = 0; ok && (c < header.chunks); c++) {
+        TrajectoryChunkHeader chunk;
+        std::memcpy(&chunk, base + offset, sizeof(chunk));
+        const uint8_t* values = base + offset + sizeof(chunk) + (chunk.trajectories * sizeof(TrajectoryEntry));
+        const uint8_t* valuesEnd = values + chunk.valuesSize;
+        ok = (valuesEnd <= base + header.tableOffset);
+        for (uint64_t t = 0; ok && (t < chunk.trajectories); t++) {
+            TrajectoryEntry e;
+            std::memcpy(&e, base + offset + sizeof(chunk) + (t * sizeof(TrajectoryEntry)), sizeof(e));
+            const uint8_t* p = values + e.offset;
+            for (uint32_t d = 0; d < e.debts; d++) {
+                std::string_view id = ((e.profile < ids.size()) && (d < ids[e.profile].size()))
+                                          ? std::string_view(ids[e.profile][d])
+                                          : std::string_view("?");
+                int64_t cents = 0;
+                for (uint32_t m = 0; m < e.months; m++) {
+                    cents += getVarint(p, valuesEnd);
+                    block += std::format("{},{},{},{},{},{:.2f}\n", e.profile, e.block, e.iteration, m + 1, id,
+                                         static_cast<double>(cents) / static_cast<double>(header.scale));
+                }
+            }
+            if (block.size() > (1 << 20)) {
+                output << block;
+                block.clear();
+            }
+        }
+        offset = static_cast<uint64_t>(valuesEnd - base);
+    }
+    output << block;
+    ::munmap(map, size);
+    output.close();
+    if (!ok) {
+        std::cerr << "Error: Truncated trajectory file: " << path << '\n';
+    } else if (!output) {
+        std::cerr << "Error: Could not write file: " << csvPath << '\n';
+    }
+    return ok && output.good();
+}
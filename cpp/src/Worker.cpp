@@ -1,204 +1,254 @@
 /**
- * @file Worker.hpp
- * @brief Defines a Worker class to simulate financial operations and debt payment strategies.
+ * @file Worker.cpp
+ * @brief Implements the Worker class simulating the trajectories of its chunks.
  */
 
 #include "Worker.hpp"
 
 #include <algorithm>
-#include <cmath>
-#include <cstdio>
-#include <cstdlib>
-#include <fstream>
-#include <functional>
-#include <iostream>
-#include <mutex>
-#include <ostream>
-#include <print>
+#include <optional>
 
+#include "Instrumentation.hpp"
 #include "flags.hpp"
 
-static constexpr double paymentGrowthRate = 0.5;                  ///< Multiplier on payment range after promotion.
-static constexpr int paymentGrowthFrequency = 36;                 ///< Promotion or job change cadence (in periods).
-static constexpr double paymentMin = 2000.0 + AGGRESSIVE_OFFSET;  ///< Minimum payment with offset.
-static constexpr double paymentMax = 3000.0 + AGGRESSIVE_OFFSET;  ///< Maximum payment with offset.
-
-// Out-of-line static initialization
-std::mutex Worker::rngMutex = std::mutex();
-std::vector<Debt> Worker::masterDebt = {};
-std::mt19937 Worker::gen = std::mt19937(std::random_device()());
-std::uniform_real_distribution<double> Worker::distr = std::uniform_real_distribution<double>(paymentMin, paymentMax);
+/**
+ * @brief Constructs a Worker object.
+ * @param id Unique ID for the worker, selecting its scheduler deque.
+ * @param job Simulation the worker belongs to; must outlive the worker.
+ */
+Worker::Worker(unsigned int id, const Job& job) : id(id), job(&job), sampler(job.seed, 0) {}
 
 /**
- * @brief Main simulation function for the worker.
+ * @brief Simulates chunks of the job's current round until its scheduler runs dry.
  */
 void Worker::run() {
-    std::ofstream file;
-    file.open(FILE_PREFIX + std::to_string(this->id) + ".csv");
-    std::vector<Debt> debts;
-    int periods = 0;
-    for (int i = 0; i < this->iter; i++) {
-        for (auto d : masterDebt) {
-            debts.emplace_back(d.principal, d.rate, d.interestPeriod, d.id, d.minimumMonthlyPayment, d.periodTaken);
+    const std::vector<Profile>* profiles = this->job->profiles;
+    // Scratch portfolios for the scalar engine are copied on the first chunk of each profile and kept across rounds,
+    // as are the statistics of an adaptive run
+    std::vector<std::vector<Portfolio>>& debts = this->debts;
+    std::vector<std::vector<TrajectoryResult>>& results = this->results;
+    debts.resize(profiles->size());
+    this->stats.resize(profiles->size());
+
+    while (std::optional<Chunk> chunk = this->job->scheduler->next(this->id)) {
+        auto [group, block, begin, end, first, index] = *chunk;
+        const std::vector<Cell>& cells = (*profiles)[group].sweep.getCells();
+        if (debts[group].empty()) {
+            INSTRUMENT_SCOPE(PHASE_COPY);
+            for (const Cell& cell : cells) {
+                debts[group].push_back(cell.portfolio);
+            }
         }
-
-        // sort by decreasing interest rate
-        std::ranges::sort(debts, std::ranges::greater(), &Debt::rate);
-        for (auto& d : debts) {
-            d.periods = 0;
+        this->stats[group].resize(cells.size());
+        while (results.size() < cells.size()) {
+            results.emplace_back(BATCH_CHUNK);
         }
-        periods = 0;
-        double totalPaid = 0.0;
-        while (true) {
-            DEBUG_PRINT("{:.2f},{:.2f}", getTotalDebt(debts), getTotalPaid(debts) + totalPaid);
-            for (auto& d : debts) {
-                d.accrue();
+        std::vector<ResultStats>& groupStats = this->stats[group];
+        // Only this worker writes the chunk's slot; simulate() sized it for the chunk's profile
+        ChunkStats* moments = this->job->chunkStats->data() + (*this->job->chunkSlots)[index];
+        for (size_t c = 0; c < cells.size(); c++) {
+            simulateChunk(cells[c], debts[group][c], block, begin, end, results[c].data());
+            INSTRUMENT_SCOPE(PHASE_STATS);
+            INSTRUMENT_COUNT(COUNTER_TRAJECTORIES, end - begin);
+            for (int i = 0; i < (end - begin); i++) {
+                groupStats[c].addCounts(results[c][i]);
+                moments[c].paid.add(results[c][i].totalPaid);
+                moments[c].periods.add(static_cast<double>(results[c][i].periods));
+                INSTRUMENT_COUNT(COUNTER_MONTHS, results[c][i].periods);
             }
-
-            double payment = getRandom(periods);
-            payForcedDebt(debts, payment);
-            payNonForcedDebt(debts, payment);
-
-            for (auto& d : debts) {
-                if (Debt::isBasicallyZero(d.principal)) {
-                    totalPaid += d.totalPaid;
+            if (c > 0) {
+                for (int i = 0; i < (end - begin); i++) {
+                    moments[c].delta.add(results[0][i], results[c][i]);
                 }
             }
-
-            auto isZero = [](Debt& d) { return Debt::isBasicallyZero(d.principal); };
-            auto new_end = std::ranges::remove_if(debts, isZero);
-            debts.erase(new_end.begin(), debts.end());
-            periods++;
-#if (KID)
-            if ((debts.size() == 1) && (debts[0].id == "\"kid\"")) {
-                // for the purposes of this exercise we're only interested in when we pay off the student loans, not
-                // when we acquire enough money to stash away to fully raise the child
-                debts.clear();
-                break;
-            }
-#endif
-
-            if (!Debt::isBasicallyZero(payment)) {
-                break;
-            }
         }
-        file << std::format("{:.2f}", totalPaid) << "," << periods << std::endl;
+        if (this->job->sink != nullptr) {
+            INSTRUMENT_TIME(PHASE_SINK,
+                            this->job->sink->write(first, {results[0].data(), static_cast<size_t>(end - begin)}));
+        }
+        if (this->job->recorder != nullptr) {
+            record(cells[0], debts[group][0], group, block, begin, end);
+        }
     }
-    file.close();
-}
-
-/**
- * @brief Starts the worker thread.
- */
-void Worker::start() { t = std::thread(&Worker::run, this); }
-
-/**
- * @brief Joins the worker thread to the main thread.
- */
-void Worker::join() { t.join(); }
-
-/**
- * @brief Sets the shared debt configuration for all workers.
- * @param d Reference to the debt vector.
- */
-void Worker::setMasterDebt(std::vector<Debt>& d) { Worker::masterDebt = d; }
-
-/**
- * @brief Calculates a random payment amount based on the period.
- * @param period The current simulation period.
- * @return Random payment amount.
- */
-auto Worker::getRandom(int period) -> double {
-    std::lock_guard<std::mutex> lock(rngMutex);
-    static bool first = true;
-    if (first) {
-        std::pair<double, double> p = getPayRange(period);
-        first = false;
-        distr = std::uniform_real_distribution<double>(p.first, p.second);
+    if (this->job->recorder != nullptr) {
+        this->job->recorder->flush(this->recorded);
     }
-
-    return distr(gen);
 }
 
 /**
- * @brief Calculates a range of payment amounts based on the simulation period.
- * @param periods The current number of periods elapsed.
- * @return A pair representing the minimum and maximum payment amounts.
+ * @brief Simulates iterations [begin, end) of a block under one cell.
+ * @param cell Cell to simulate.
+ * @param debts Scratch copy of the cell's portfolio for the scalar engine.
+ * @param block Block, selecting the random stream.
+ * @param begin First iteration.
+ * @param end One past the last iteration.
+ * @param out Destination; the result of iteration i is written to out[i - begin].
  */
-auto Worker::getPayRange(int periods) -> std::pair<double, double> {
-    double growth = 1.0 + (paymentGrowthRate * std::floor((static_cast<double>(periods) / paymentGrowthFrequency)));
-    return {paymentMin * growth, paymentMax * growth};
+void Worker::simulateChunk(const Cell& cell, Portfolio& debts, uint64_t block, int begin, int end,
+                           TrajectoryResult* out) {
+    const Scenario& s = cell.scenario;
+    withPolicy(s.aggressive, s.kid, Strategy::isProportional(s.strategy),
+               [&]<PaymentPolicy P>() { simulateChunkWith<P>(cell, debts, block, begin, end, out); });
 }
 
 /**
- * @brief Pays off forced debts using available payment.
- * @param debts Reference to the vector of debts.
- * @param payment Reference to the payment amount.
+ * @brief simulateChunk instantiated for the cell's policy.
+ * @tparam P Policy of the month loop.
  */
-void Worker::payForcedDebt(std::vector<Debt>& debts, double& payment) {
-#if AGGRESSIVE
-    // Use payment towards forced debts
-    for (auto& d : debts) {
-        if (d.isForced() && (d.periods >= d.periodTaken)) {
-            double forced = d.minimumMonthlyPayment;
-            d.pay(forced);
-            payment -= (d.minimumMonthlyPayment - forced);
+template <PaymentPolicy P>
+void Worker::simulateChunkWith(const Cell& cell, Portfolio& debts, uint64_t block, int begin, int end,
+                               TrajectoryResult* out) {
+    const Job& j = *this->job;
+    this->income = &cell.income;
+    this->maxPeriods = cell.scenario.maxPeriods;
+    // Debug prints only exist in the scalar engine
+    if (j.events && !DEBUG) {
+        this->sampler = Sampler(j.seed, block, j.sampling, j.samplingMonths);
+        for (int i = begin; i < end; i++) {
+            out[i - begin] = simulateEvents<P>(debts, i);
         }
+        return;
     }
-#else
-    // Do not use payment towards forced debts; treat as QoL boost
-    for (auto& d : debts) {
-        if (d.isForced() && (d.periods >= d.periodTaken)) {
-            d.pay(d.minimumMonthlyPayment);
-        }
+    if (j.simd && !DEBUG) {
+        INSTRUMENT_SCOPE(PHASE_BATCH);
+        BatchEngine(cell.portfolio, cell.income, Sampler(j.seed, block, j.sampling, j.samplingMonths), cell.scenario)
+            .run(begin, end, out);
+        return;
+    }
+    this->sampler = Sampler(j.seed, block, j.sampling, j.samplingMonths);
+    for (int i = begin; i < end; i++) {
+        out[i - begin] = simulate<P>(debts, i);
     }
-#endif
 }
 
 /**
- * @brief Pays off non-forced debts using available payment.
- * @param debts Reference to the vector of debts.
- * @param payment Reference to the payment amount.
+ * @brief Records the sampled iterations of [begin, end) of a block to the job's recorder.
+ * @param cell Cell to record.
+ * @param debts Scratch copy of the cell's portfolio.
+ * @param group Profile of the cell.
+ * @param block Block, selecting the random stream.
+ * @param begin First iteration.
+ * @param end One past the last iteration.
  */
-void Worker::payNonForcedDebt(std::vector<Debt>& debts, double& payment) {
-    for (auto& d : debts) {
-        // Only pay minimum monthly payments on forced debts
-        if (!d.isForced()) {
-            d.pay(payment);
-            if (Debt::isBasicallyZero(payment)) {
-                return;
+void Worker::record(const Cell& cell, Portfolio& debts, size_t group, uint64_t block, int begin, int end) {
+    const Job& j = *this->job;
+    const Scenario& s = cell.scenario;
+    this->income = &cell.income;
+    this->maxPeriods = cell.scenario.maxPeriods;
+    this->sampler = Sampler(j.seed, block, j.sampling, j.samplingMonths);
+    withPolicy(s.aggressive, s.kid, Strategy::isProportional(s.strategy), [&]<PaymentPolicy P>() {
+        for (int i = begin; i < end; i++) {
+            if (!j.recorder->isSampled(static_cast<uint64_t>(i))) {
+                continue;
             }
+            this->recorded.begin(debts.size());
+            TrajectoryResult r = simulate<P>(debts, i, [this](const Portfolio& p) { this->recorded.month(p); });
+            this->recorded.end({static_cast<uint32_t>(group), static_cast<uint32_t>(block), static_cast<uint32_t>(i),
+                                0, 0, 0, 0, r.totalPaid});
         }
+    });
+    if (this->recorded.size() >= TrajectoryRecorder::BUFFER_BYTES) {
+        j.recorder->flush(this->recorded);
     }
+}
+
+/**
+ * @brief Simulates one trajectory with the scalar engine.
+ * @param debts Portfolio to simulate; reset by this function.
+ * @param i Iteration index, selecting the random stream.
+ * @param observe Called with the portfolio at the end of every month.
+ * @return Outcome of the trajectory.
+ * @tparam P Policy of the month loop.
+ */
+template <PaymentPolicy P, class Observer>
+auto Worker::simulate(Portfolio& debts, int i, Observer observe) -> TrajectoryResult {
+    this->sampler.seek(i);
+    this->shock = 0;
+    INSTRUMENT_TIME(PHASE_RESET, debts.reset());
+    int periods = 0;
+    double totalPaid = 0.0;
+    while (true) {
+        DEBUG_PRINT("{:.2f},{:.2f}", debts.getTotalDebt(), debts.getTotalPaid() + totalPaid);
+        INSTRUMENT_TIME(PHASE_ACCRUE, debts.accrue());
+
+        double payment = getRandom(periods);
+        INSTRUMENT_TIME(PHASE_PAY, debts.payForced<P::aggressive>(payment);
+                        debts.payNonForced<P::proportional>(payment));
+
+        INSTRUMENT_TIME(PHASE_RETIRE, debts.retirePaidOff(totalPaid));
+        periods++;
+        observe(debts);
+        if (P::kid && debts.isOnlyKidLeft()) {
+            // for the purposes of this exercise we're only interested in when we pay off the student loans, not
+            // when we acquire enough money to stash away to fully raise the child
+            break;
+        }
 
-    // If all non-forced debts are zero, pay off forced debts early
-    for (auto& d : debts) {
-        d.pay(payment);
+        if (!Debt::isBasicallyZero(payment)) {
+            break;
+        }
+        if (periods >= this->maxPeriods) {
+            return {totalPaid, periods, true};
+        }
     }
+    return {totalPaid, periods};
 }
 
 /**
- * @brief Calculates the total debt from a vector of debts.
- * @param debts Reference to the vector of debts.
- * @return Total debt amount.
+ * @brief Simulates one trajectory with the event-driven scalar engine, bit-identical to simulate().
+ *
+ * Between two events (a debt taken, a compounding boundary, a debt paid off) a period only pays the forced debts
+ * and the first taken debt in payment order, so those periods skip the passes over the whole portfolio.
+ * @param debts Portfolio to simulate; reset by this function.
+ * @param i Iteration index, selecting the random stream.
+ * @return Outcome of the trajectory.
+ * @tparam P Policy of the month loop.
  */
-auto Worker::getTotalDebt(std::vector<Debt>& debts) -> double {
-    double res = 0.0;
-    for (auto d : debts) {
-        res += d.getPrincipal();
+template <PaymentPolicy P>
+auto Worker::simulateEvents(Portfolio& debts, int i) -> TrajectoryResult {
+    this->sampler.seek(i);
+    this->shock = 0;
+    debts.reset();
+    int periods = 0;
+    double totalPaid = 0.0;
+    // The first period is always a full one, which retires the debts that start at zero
+    double payment = getRandom(periods);
+    while (true) {
+        debts.accrue();
+        debts.payForced<P::aggressive>(payment);
+        debts.payNonForced<P::proportional>(payment);
+        debts.retirePaidOff(totalPaid);
+        periods++;
+        if ((P::kid && debts.isOnlyKidLeft()) || !Debt::isBasicallyZero(payment)) {
+            break;
+        }
+        if (periods >= this->maxPeriods) {
+            return {totalPaid, periods, true};
+        }
+
+        payment = getRandom(periods);
+        // A proportional split pays every debt each period, so only cascading strategies have quiet periods. The
+        // last period before the cap is always a full one, which checks the cap as simulate() does.
+        if constexpr (!P::proportional) {
+            int event = std::min(debts.nextEvent(), this->maxPeriods);
+            while (((periods + 1) < event) && debts.payQuiet<P::aggressive>(payment)) {
+                periods++;
+                payment = getRandom(periods);
+            }
+        }
     }
-    return res;
+    return {totalPaid, periods};
 }
 
 /**
- * @brief Calculates the total paid amount from a vector of debts.
- * @param debts Reference to the vector of debts.
- * @return Total paid amount.
+ * @brief Gets the random payment of a period, drawing the next block of months when it starts one.
+ * @param period The current simulation period; periods are visited in order from 0.
+ * @return Random payment amount.
  */
-auto Worker::getTotalPaid(std::vector<Debt>& debts) -> double {
-    double res = 0.0;
-    for (auto d : debts) {
-        res += d.getTotalPaid();
+auto Worker::getRandom(int period) -> double {
+    if ((period % IncomeModel::BLOCK) == 0) {
+        INSTRUMENT_SCOPE(PHASE_DRAW);
+        this->income->draw(this->sampler, period, this->shock, this->payments);
     }
-    return res;
+    return this->payments[period % IncomeModel::BLOCK];
 }
@@ -1,136 +1,381 @@
 /**
  * @file main.cpp
- * @brief Entry point for the simulation program. Configures workers, parses data, and runs simulations.
+ * @brief Command-line front end of libfinances: parses the configuration, runs simulate() and prints the results.
  */
 
-#include <algorithm>
-#include <cmath>
-#include <cstdio>
-#include <cstdlib>
+#include <charconv>
 #include <filesystem>
+#include <format>
 #include <fstream>
-#include <functional>
 #include <iostream>
-#include <ostream>
+#include <memory>
+#include <optional>
 #include <print>
-#include <thread>
+#include <string_view>
 #include <vector>
 
-#include "CsvParser.hpp"
-#include "Worker.hpp"
+#include "Config.hpp"
+#include "Instrumentation.hpp"
+#include "Profile.hpp"
+#include "Report.hpp"
+#include "ResultSink.hpp"
+#include "ResultStore.hpp"
+#include "Shard.hpp"
+#include "Simulation.hpp"
+#include "Statistics.hpp"
+#include "TrajectoryRecorder.hpp"
 #include "flags.hpp"
 
+namespace {
+
 /**
- * @brief Converts yearly interest rate to a monthly rate for a given debt.
- * @param d Reference to the debt object.
+ * @brief Parses a whole string as a number.
+ * @param s String to parse.
+ * @param value Parsed value; unchanged on failure.
+ * @return True if the string is a valid number.
+ * @tparam T Type of the number.
  */
-void convertToMonthly(Debt& d) {
-    d.rate = d.rate / Debt::convertPeriods(d.interestPeriod, Debt::PERIOD_MONTHLY);
-    d.interestPeriod = Debt::PERIOD_MONTHLY;
+template <class T>
+auto parseNumber(std::string_view s, T& value) -> bool {
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+    return (ec == std::errc()) && (ptr == s.data() + s.size());
 }
 
 /**
- * @brief Calculates the total non-forced debt from a vector of debts.
- * @param debts Reference to the vector of debts.
- * @return Total non-forced debt amount.
+ * @brief Prints the statistics of every profile: summary lines, sweep tables or JSON, as configured.
+ * @param config Configuration of the run.
+ * @param profiles Profiles of the run.
+ * @param results Results of the run.
  */
-auto getTotalNonForcedDebt(std::vector<Debt>& debts) -> double {
-    double res = 0.0;
-    for (auto d : debts) {
-        if (!Debt::isBasicallyZero(d.minimumMonthlyPayment)) {
-            res += d.getPrincipal();
+void printResults(const Config& config, const std::vector<Profile>& profiles, const Results& results) {
+    bool batch = !config.portfolios.empty();
+    if (config.json && batch) {
+        std::println("[");
+    }
+    for (size_t g = 0; g < profiles.size(); g++) {
+        const Profile& profile = profiles[g];
+        const std::vector<ResultStats>& stats = results.profiles[g].stats;
+        const std::vector<DeltaStats>& deltas = results.profiles[g].deltas;
+        std::string json;
+        if (config.sweep.empty()) {
+            if (config.json) {
+                json = stats[0].toJson();
+            } else {
+                stats[0].print(profile.name);
+            }
+        } else if (config.json) {
+            json = profile.sweep.toJson(stats, deltas);
+        } else {
+            if (batch) {
+                std::println("{}:", profile.name);
+            }
+            profile.sweep.printTable(stats, deltas);
+        }
+        if ((config.sampling != Sampler::MODE_PLAIN) && !config.json) {
+            const ReplicateStats& replicates = results.profiles[g].replicates[0];
+            std::println("{} sampling over {} blocks: variance reduction vs plain Monte Carlo x{:.2f} totalPaid, "
+                         "x{:.2f} months",
+                         Sampler::printMode(config.sampling), results.blocks,
+                         ReplicateStats::varianceReduction(replicates.paid),
+                         ReplicateStats::varianceReduction(replicates.periods));
+        }
+        if (config.json) {
+            if (batch) {
+                std::println("{{\"name\": {}, \"results\": {}}}{}", jsonString(profile.name), json,
+                             (g + 1 < profiles.size()) ? "," : "");
+            } else {
+                std::println("{}", json);
+            }
         }
     }
-    return res;
+    if (config.json && batch) {
+        std::println("]");
+    }
 }
 
 /**
- * @brief Calculates the total owed on non-forced debts from a vector of debts.
- * @param debts Reference to the vector of debts.
- * @return Total owed amount on non-forced debts.
+ * @brief Answers queries about an indexed results file (`finances query`), see Config::printUsage.
+ * @param argc Argument count, "query" excluded.
+ * @param argv The results file, then queries and their options.
+ * @return Exit code (0 for success).
  */
-auto getTotalOwedNonForced(std::vector<Debt>& debts) -> double {
-    double res = 0.0;
-    for (auto d : debts) {
-        if (!d.isForced()) {
-            res += d.principal;
+auto query(int argc, char** argv) -> int {
+    if (argc < 1) {
+        Config::printUsage();
+        return 1;
+    }
+    std::unique_ptr<ResultStore> store = ResultStore::open(argv[0]);
+    if (!store) {
+        return 1;
+    }
+    uint64_t group = 0;
+    PeriodRange range;
+    bool ranged = false;
+    std::vector<std::string_view> queries;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if ((arg == "--profile") || (arg == "--months")) {
+            std::string_view value = (i + 1 < argc) ? argv[++i] : "";
+            size_t colon = value.find(':');
+            bool ok = (arg == "--profile") ? (parseNumber(value, group) && (group < store->groups()))
+                                           : ((colon != std::string_view::npos) &&
+                                              parseNumber(value.substr(0, colon), range.lo) &&
+                                              parseNumber(value.substr(colon + 1), range.hi));
+            if (!ok) {
+                std::cerr << "Error: Invalid value for " << arg << ": " << value << '\n';
+                return 1;
+            }
+            ranged = ranged || (arg == "--months");
+        } else {
+            queries.push_back(arg);
+        }
+    }
+
+    for (std::string_view q : queries) {
+        double x = 0.0;
+        uint64_t n = 0;
+        if (q == "count") {
+            std::println("count: {}", store->count(group, range));
+        } else if (q == "mean") {
+            std::println("mean: paid {:.2f}, months {:.2f}", store->paidMean(group, range),
+                         store->periodsMean(group, range));
+        } else if ((q == "std") && !ranged) {
+            const ResultGroupIndex& s = store->summary(group);
+            std::println("std: paid {:.2f}, months {:.2f}", s.paidStd, s.periodsStd);
+        } else if (q.starts_with('p') && parseNumber(q.substr(1), x) && (x >= 0.0) && (x <= 100.0)) {
+            std::println("{}: paid {:.2f}, months {}", q, store->paidQuantile(group, x / 100.0, range),
+                         store->periodsQuantile(group, x / 100.0, range));
+        } else if (q.starts_with("paid<") && parseNumber(q.substr(5), x)) {
+            std::println("P({}): {:.6f}", q, store->paidBelow(group, x, range));
+        } else if (q.starts_with("months<=") && parseNumber(q.substr(8), n)) {
+            std::println("P({}): {:.6f}", q, store->periodsBelow(group, n + 1, range));
+        } else if (q.starts_with("months<") && parseNumber(q.substr(7), n)) {
+            std::println("P({}): {:.6f}", q, store->periodsBelow(group, n, range));
+        } else {
+            std::cerr << "Error: Unknown query: " << q << '\n';
+            return 1;
         }
     }
-    return res;
+    return 0;
 }
 
 /**
- * @brief Gets the count of non-forced debts from a vector of debts.
- * @param debts Reference to the vector of debts.
- * @return Count of non-forced debts.
+ * @brief Summarizes result files written with --write-results (`finances report`), see Config::printUsage.
+ *
+ * Prints the same summary lines as a simulation, labelled with each file's name without its extension.
+ * @param argc Argument count, "report" excluded.
+ * @param argv Result files and options.
+ * @return Exit code (0 for success).
  */
-auto getNumNonForced(std::vector<Debt>& debts) -> int {
-    int res = 0;
-    for (auto d : debts) {
-        if (!d.isForced()) {
-            res++;
+auto report(int argc, char** argv) -> int {
+    unsigned int threads = 0;
+    bool json = false;
+    std::vector<std::string> paths;
+    for (int i = 0; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if ((arg == "--threads") || (arg == "--json")) {
+            std::string_view value = (i + 1 < argc) ? argv[++i] : "";
+            bool ok = (arg == "--threads") ? parseNumber(value, threads) : ((value == "true") || (value == "false"));
+            json = (arg == "--json") ? (value == "true") : json;
+            if (!ok) {
+                std::cerr << "Error: Invalid value for " << arg << ": " << value << '\n';
+                return 1;
+            }
+        } else {
+            paths.emplace_back(arg);
+        }
+    }
+    if (paths.empty()) {
+        Config::printUsage();
+        return 1;
+    }
+
+    ThreadPool pool(threads);
+    std::optional<std::vector<ResultStats>> stats = Report::summarize(paths, pool);
+    if (!stats) {
+        return 1;
+    }
+    if (json) {
+        std::println("[");
+    }
+    for (size_t f = 0; f < paths.size(); f++) {
+        std::string name = std::filesystem::path(paths[f]).stem().string();
+        if (json) {
+            std::println("{{\"name\": {}, \"results\": {}}}{}", jsonString(name), (*stats)[f].toJson(),
+                         (f + 1 < paths.size()) ? "," : "");
+        } else {
+            (*stats)[f].print(name);
         }
     }
-    return res;
+    if (json) {
+        std::println("]");
+    }
+    return 0;
 }
 
 /**
- * @brief Entry point of the simulation program.
- * Initializes the workers, parses CSV data, and combines simulation results.
+ * @brief Merges the shard files of a run split with --shard (`finances merge`), see Config::printUsage.
+ *
+ * Prints what the unsharded run would have printed. The profiles are rebuilt from the options recorded in the
+ * shards, so their debt files must be readable from the current directory.
+ * @param argc Argument count, "merge" excluded.
+ * @param argv Shard files and options.
  * @return Exit code (0 for success).
  */
-auto main() -> int {
-    DEBUG_PRINT("creating {} threads", std::thread::hardware_concurrency());
-
-    CsvParser csv("../debt.csv");
-    std::ofstream simulations;
-    std::vector<Worker> workers;
-    static std::vector<Debt> masterDebt;
-#if (DEBUG)
-    unsigned int numWorkers = 1;
-#else
-    unsigned int numWorkers = std::thread::hardware_concurrency();
-#endif
-    // Parse CSV File
-    if (auto data = csv.parse()) {
-        for (const auto& row : *data) {
-            double principal = std::stod(row[0]);
-            int monthTaken = std::stoi(row[1]);
-            double rate = std::stod(row[2]);
-            double minimumMonthlyPayment = std::stod(row[3]);
-            std::string id = row[4];
-            DEBUG_PRINT("{:.2f} {:.2f} {}", principal, rate, id);
-            masterDebt.emplace_back(principal, rate, Debt::PERIOD_YEARLY, id, minimumMonthlyPayment, monthTaken);
+auto merge(int argc, char** argv) -> int {
+    bool json = false;
+    std::vector<std::string> paths;
+    for (int i = 0; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (arg == "--json") {
+            std::string_view value = (i + 1 < argc) ? argv[++i] : "";
+            if ((value != "true") && (value != "false")) {
+                std::cerr << "Error: Invalid value for " << arg << ": " << value << '\n';
+                return 1;
+            }
+            json = (value == "true");
+        } else {
+            paths.emplace_back(arg);
+        }
+    }
+    if (paths.empty()) {
+        Config::printUsage();
+        return 1;
+    }
+
+    std::string options;
+    std::optional<Results> results = Shard::merge(paths, options);
+    Config config;
+    if (!results || !config.apply(options, paths[0])) {
+        return 1;
+    }
+    config.json = json;
+    std::optional<std::vector<Profile>> profiles = Profile::loadAll(config);
+    if (!profiles) {
+        return 1;
+    }
+    for (size_t g = 0; g < results->profiles.size(); g++) {
+        if ((profiles->size() != results->profiles.size()) ||
+            ((*profiles)[g].sweep.getCells().size() != results->profiles[g].stats.size())) {
+            std::cerr << "Error: The debt files no longer match the shards\n";
+            return 1;
         }
     }
+    printResults(config, *profiles, *results);
+    return 0;
+}
+
+/**
+ * @brief Converts a binary results or trajectory file to CSV (`finances export`), see Config::printUsage.
+ *
+ * The kind of file is told by its magic number.
+ * @param argc Argument count, "export" excluded.
+ * @param argv Binary file and CSV file.
+ * @return Exit code (0 for success).
+ */
+auto exportCsv(int argc, char** argv) -> int {
+    if (argc != 2) {
+        Config::printUsage();
+        return 1;
+    }
+    uint64_t magic = 0;
+    std::ifstream(argv[0], std::ios_base::binary).read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    if (magic == TrajectoryFileHeader::MAGIC) {
+        return TrajectoryRecorder::exportCsv(argv[0], argv[1]) ? 0 : 1;
+    }
+    return BinaryResultSink::exportCsv(argv[0], argv[1]) ? 0 : 1;
+}
 
-    Worker::setMasterDebt(masterDebt);
+}  // namespace
 
-    for (auto& d : masterDebt) {
-        convertToMonthly(d);
+/**
+ * @brief Entry point of the simulation program.
+ * Loads the profiles, simulates them and prints their statistics.
+ * @param argc Argument count.
+ * @param argv Argument values, see Config::printUsage.
+ * @return Exit code (0 for success).
+ */
+auto main(int argc, char** argv) -> int {
+    if ((argc > 1) && (std::string_view(argv[1]) == "query")) {
+        return query(argc - 2, argv + 2);
     }
+    if ((argc > 1) && (std::string_view(argv[1]) == "report")) {
+        return report(argc - 2, argv + 2);
+    }
+    if ((argc > 1) && (std::string_view(argv[1]) == "merge")) {
+        return merge(argc - 2, argv + 2);
+    }
+    if ((argc > 1) && (std::string_view(argv[1]) == "export")) {
+        return exportCsv(argc - 2, argv + 2);
+    }
+    std::optional<Config> config = Config::parse(argc, argv);
+    if (!config) {
+        return 1;
+    }
+    const Scenario& scenario = config->scenario;
 
-    std::ranges::sort(masterDebt, std::ranges::greater(), &Debt::rate);
+    // Debts keep their yearly rates, which is what the workers have always simulated
+    std::optional<std::vector<Profile>> profiles = Profile::loadAll(*config);
+    if (!profiles) {
+        return 1;
+    }
 
-    simulations.open("simulations.csv", std::ios_base::binary);
-    for (unsigned int i = 0; i < numWorkers; i++) {
-        workers.emplace_back(ITERATIONS / numWorkers, i);
+    Options options = Options::fromConfig(*config);
+    std::unique_ptr<ResultSink> sink;
+    if (config->writeResults && (config->targetCi > 0.0)) {
+        std::cerr << "Error: --write-results cannot be combined with --target-ci\n";
+        return 1;
+    }
+    // Every shard must draw from the same random streams, and only the merge sees the whole run
+    if ((config->shards > 1) && (!config->seed || config->writeResults || (config->targetCi > 0.0))) {
+        std::cerr << "Error: --shard needs --seed and cannot be combined with --write-results or --target-ci\n";
+        return 1;
+    }
+    if (config->writeResults) {
+        if (config->resultBinary) {
+            sink = BinaryResultSink::open("simulations.bin", scenario.iterations, profiles->size());
+        } else {
+            auto csvSink = std::make_unique<CsvResultSink>("simulations.csv");
+            sink = csvSink->isOpen() ? std::move(csvSink) : nullptr;
+        }
+        if (!sink) {
+            return 1;
+        }
+        options.sink = sink.get();
     }
-    for (auto& w : workers) {
-        w.start();
+    std::unique_ptr<TrajectoryRecorder> recorder;
+    if (config->recordEvery > 0) {
+        recorder = TrajectoryRecorder::open("trajectories.bin", config->recordEvery, *profiles);
+        if (!recorder) {
+            return 1;
+        }
+        options.recorder = recorder.get();
     }
-    for (auto& w : workers) {
-        w.join();
+
+    std::optional<Results> results = simulate(*profiles, scenario.iterations, options);
+    if (!results || (sink && !sink->close()) || (recorder && !recorder->close())) {
+        return 1;
     }
-    for (unsigned int i = 0; i < numWorkers; i++) {
-        std::string partialSim = FILE_PREFIX + std::to_string(i) + ".csv";
-        std::ifstream input{partialSim, std::ios_base::binary};
-        simulations << input.rdbuf();
-        input.close();
-        std::filesystem::remove(std::string(partialSim));
+    if ((config->targetCi > 0.0) && !config->json) {
+        std::println("stopped after {} iterations, widest {:.0f}% interval +-{:.6f}%", results->iterations,
+                     config->confidence * 100.0, results->widestHalfWidth * 100.0);
     }
 
-    simulations.close();
+    if (config->shards > 1) {
+        std::string path = std::format("shard_{}.bin", config->shard);
+        if (!Shard::write(path, *results, config->options)) {
+            return 1;
+        }
+        std::println("shard {}/{} written to {}; combine every shard with finances merge", config->shard,
+                     config->shards, path);
+    } else {
+        printResults(*config, *profiles, *results);
+    }
+#if (INSTRUMENT)
+    // stderr keeps the statistics on stdout parseable
+    Instrumentation::Totals totals = Instrumentation::totals();
+    std::println(stderr, "{}", config->json ? Instrumentation::toJson(totals) : Instrumentation::toString(totals));
+#endif
 
     return 0;
 }
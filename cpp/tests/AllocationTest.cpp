@@ -0,0 +1,132 @@
+/**
+ * @file AllocationTest.cpp
+ * @brief Checks that a warm Worker simulates its chunks without touching the heap, with every engine.
+ *
+ * A counting global operator new is armed around Worker::run() only. Each engine simulates a round to build its
+ * scratch portfolios, result buffers and statistics bins, then the same round again as simulate() runs its rounds;
+ * the second chunk loop must not allocate at all.
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <optional>
+#include <print>
+#include <string>
+#include <vector>
+
+#include "Config.hpp"
+#include "Debt.hpp"
+#include "Profile.hpp"
+#include "Scheduler.hpp"
+#include "Statistics.hpp"
+#include "Sweep.hpp"
+#include "Worker.hpp"
+#include "flags.hpp"
+
+namespace {
+
+std::atomic<bool> armed{false};        ///< Counts allocations while set.
+std::atomic<uint64_t> allocations{0};  ///< Allocations made while armed.
+
+constexpr uint64_t SEED = 42;                     ///< Seed of every random stream of the test.
+constexpr uint64_t ITERATIONS = 4 * BATCH_CHUNK;  ///< Iterations of a round, several chunks per block.
+constexpr uint64_t BLOCKS = 2;                    ///< Random streams of a round.
+
+/**
+ * @brief Builds a small portfolio with yearly and monthly rates, a forced debt and a late debt.
+ * @return Debts of the test.
+ */
+auto testDebts() -> std::vector<Debt> {
+    std::vector<Debt> debts;
+    debts.emplace_back(1000.0, 0.28, Debt::PERIOD_YEARLY, "credit card", 0.0, 0);
+    debts.emplace_back(2600.0, 0.28, Debt::PERIOD_YEARLY, "laptop", 0.0, 12);
+    debts.emplace_back(5000.0, 0.0, Debt::PERIOD_YEARLY, "auto", 475.0, 0);
+    debts.emplace_back(20000.0, 0.079, Debt::PERIOD_MONTHLY, "student loan", 0.0, 0);
+    debts.emplace_back(120000.0, 0.0, Debt::PERIOD_YEARLY, "down payment", 0.0, 0);
+    return debts;
+}
+
+/**
+ * @brief Runs one round of a job on a single worker, as simulate() does on each pool thread.
+ * @param worker Worker to run.
+ * @param job Job of the worker; its scheduler and chunk buffers are set for the round.
+ * @param count Counts the allocations of the chunk loop.
+ */
+void runRound(Worker& worker, Job& job, bool count) {
+    Scheduler scheduler(ITERATIONS, BLOCKS, 1, BATCH_CHUNK);
+    size_t cells = (*job.profiles)[0].sweep.getCells().size();
+    std::vector<size_t> chunkSlots(scheduler.getChunks().size());
+    for (const Chunk& chunk : scheduler.getChunks()) {
+        chunkSlots[chunk.index] = chunk.index * cells;
+    }
+    std::vector<ChunkStats> chunkStats(chunkSlots.size() * cells);
+    job.scheduler = &scheduler;
+    job.chunkStats = &chunkStats;
+    job.chunkSlots = &chunkSlots;
+    armed = count;
+    worker.run();
+    armed = false;
+}
+
+/**
+ * @brief Checks that the second round of one engine does not allocate.
+ * @param profiles Profiles to simulate.
+ * @param name Name of the engine.
+ * @param simd Uses the BatchEngine.
+ * @param events Uses the event-driven scalar engine.
+ * @return True if the check passed.
+ */
+auto checkEngine(const std::vector<Profile>& profiles, const std::string& name, bool simd, bool events) -> bool {
+    Job job;
+    job.profiles = &profiles;
+    job.seed = SEED;
+    job.simd = simd;
+    job.events = events;
+    Worker worker(0, job);
+    runRound(worker, job, false);
+    allocations = 0;
+    runRound(worker, job, true);
+    uint64_t n = allocations;
+    std::println("{}: {} allocations in the warm chunk loop", name, n);
+    return n == 0;
+}
+
+}  // namespace
+
+// Only the scalar forms are replaced; the array and nothrow forms forward to them.
+
+auto operator new(std::size_t size) -> void* {
+    if (armed.load(std::memory_order_relaxed)) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (void* p = std::malloc((size != 0) ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void* p) noexcept { std::free(p); }
+
+[[gnu::noinline]] void operator delete(void* p, [[maybe_unused]] std::size_t size) noexcept { std::free(p); }
+
+/**
+ * @brief Entry point of the allocation test.
+ * @return Exit code (0 if no engine allocates once warm).
+ */
+auto main() -> int {
+    // Two cells, so the deltas to the first cell are folded too
+    Config config;
+    config.sweep.push_back("strategy=avalanche,snowball");
+    std::optional<Sweep> sweep = Sweep::build(config, testDebts());
+    if (!sweep) {
+        return EXIT_FAILURE;
+    }
+    std::vector<Profile> profiles;
+    profiles.push_back({"test", std::move(*sweep)});
+
+    bool ok = checkEngine(profiles, "batch", true, false);
+    ok = checkEngine(profiles, "scalar", false, false) && ok;
+    ok = checkEngine(profiles, "events", false, true) && ok;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
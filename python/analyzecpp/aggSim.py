@@ -1,3 +1,7 @@
+import os
+import sys
+
+import numpy
 import pandas
 
 def printStats(df, name):
@@ -8,5 +12,22 @@ def printStats(df, name):
     print(name, str(payMean) + " +- " + str(payStd), "in " + str(timeMean) + " +- " + str(timeStd) + " months")
 
 
-loans = pandas.read_csv("../../cpp/build/simulations.csv", header=None)
+def readBinary(path):
+    # header: magic, count, paidOffset, periodsOffset, ... (uint64 each); then float64 and uint16 columns
+    count, paidOffset, periodsOffset = (int(v) for v in numpy.fromfile(path, dtype=numpy.uint64, count=4)[1:])
+    paid = numpy.fromfile(path, dtype=numpy.float64, count=count, offset=paidOffset)
+    periods = numpy.fromfile(path, dtype=numpy.uint16, count=count, offset=periodsOffset)
+    return pandas.DataFrame({0: paid, 1: periods})
+
+
+# the results file given as argument, else the newer of simulations.bin and simulations.csv
+if len(sys.argv) > 1:
+    path = sys.argv[1]
+else:
+    candidates = [p for p in ("../../cpp/build/simulations.bin", "../../cpp/build/simulations.csv") if os.path.exists(p)]
+    path = max(candidates, key=os.path.getmtime)
+if path.endswith(".bin"):
+    loans = readBinary(path)
+else:
+    loans = pandas.read_csv(path, header=None)
 printStats(loans, "simulations")